@@ -36,1617 +36,7878 @@
 
 #include <string>
 #include <cctype>
+#include <climits>
 #include <stdexcept>
 #include <sstream>
 #include <vector>
+#include <map>
 #include <algorithm>
+#include <iterator>
+#include <cstddef>
 #include <string.h>
 
+// Use SSE2, AVX2 and AVX-512 kernels with runtime CPU dispatch on x86 with GCC
+// or clang. Define STX_STRING_NO_SIMD to use only the portable scalar code.
+#if !defined(STX_STRING_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define STX_STRING_X86_SIMD 1
+#if defined(__clang__) || (__GNUC__ >= 7)
+#define STX_STRING_X86_AVX512 1
+#endif
+#include <immintrin.h>
+#endif
+
+// Provide the parallel split functions using C++11 threads. Define
+// STX_STRING_NO_THREADS to omit them.
+#if __cplusplus >= 201103L && !defined(STX_STRING_NO_THREADS)
+#define STX_STRING_THREADS 1
+#include <thread>
+#include <exception>
+#endif
+
+// Declare compile-time functions and tables constexpr with C++11.
+#if __cplusplus >= 201103L
+#define STX_STRING_CONSTEXPR constexpr
+#else
+#define STX_STRING_CONSTEXPR
+#endif
+
 namespace stx {
 namespace string {
 
-// ***                           ***
-// *** Whitespace Trim Functions ***
-// ***                           ***
+// ***                        ***
+// *** String Reference Class ***
+// ***                        ***
 
 /**
- * Trims the given string on the left and right. Removes all characters in the
- * given drop array, which defaults to " ". Returns a copy of the string.
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      new trimmed string
+ * Non-owning reference to a contiguous range of characters, stored as a
+ * pointer and a length. Functions returning string_ref objects do not copy any
+ * characters: the referenced data usually belongs to a std::string passed as
+ * argument and must outlive the string_ref.
  */
-static inline std::string trim(const std::string& str, const std::string& drop = " ")
+class string_ref
 {
-    std::string::size_type pos1 = str.find_first_not_of(drop);
-    if (pos1 == std::string::npos) return std::string();
+public:
+    typedef char value_type;
+    typedef std::string::size_type size_type;
+    typedef const char* iterator;
+    typedef const char* const_iterator;
+
+    //! construct an empty reference
+    string_ref()
+        : m_data(NULL), m_size(0)
+    { }
+
+    //! construct a reference to the characters [first,last). The template
+    //! parameter keeps a literal 0 from converting to last, hence
+    //! string_ref(data, 0) selects the size constructor.
+    template <typename Char>
+    string_ref(const char* first, Char* last)
+        : m_data(first), m_size(static_cast<size_type>(last - first))
+    { }
+
+    //! construct a reference to size characters starting at data
+    string_ref(const char* data, size_type size)
+        : m_data(data), m_size(size)
+    { }
+
+    //! construct a reference to a zero-terminated C string
+    string_ref(const char* cstr)
+        : m_data(cstr), m_size(strlen(cstr))
+    { }
+
+    //! construct a reference to the contents of a std::string
+    string_ref(const std::string& str)
+        : m_data(str.data()), m_size(str.size())
+    { }
+
+    //! construct a reference to the contents of a string with other traits
+    template <typename Traits, typename Alloc>
+    string_ref(const std::basic_string<char, Traits, Alloc>& str)
+        : m_data(str.data()), m_size(str.size())
+    { }
+
+    //! pointer to the first referenced character
+    const char* data() const { return m_data; }
+
+    //! number of referenced characters
+    size_type size() const { return m_size; }
+
+    //! number of referenced characters
+    size_type length() const { return m_size; }
+
+    //! true if no characters are referenced
+    bool empty() const { return (m_size == 0); }
+
+    //! iterator to the first character
+    const_iterator begin() const { return m_data; }
+
+    //! iterator beyond the last character
+    const_iterator end() const { return m_data + m_size; }
+
+    //! return the character at position i
+    const char& operator[] (size_type i) const { return m_data[i]; }
+
+    //! return a copy of the referenced characters as std::string
+    std::string str() const { return std::string(m_data, m_size); }
+
+    //! return a reference to at most n characters starting at pos
+    string_ref substr(size_type pos, size_type n = std::string::npos) const
+    {
+        if (pos > m_size)
+            throw(std::out_of_range("string_ref::substr() position out of range"));
+        return string_ref(m_data + pos, std::min(n, m_size - pos));
+    }
 
-    std::string::size_type pos2 = str.find_last_not_of(drop);
-    if (pos2 == std::string::npos) return std::string();
+    //! three-way comparison with the same ordering as std::string::compare()
+    int compare(const string_ref& other) const
+    {
+        size_type n = std::min(m_size, other.m_size);
+        int r = (n == 0) ? 0 : memcmp(m_data, other.m_data, n);
+        if (r != 0) return r;
+        if (m_size < other.m_size) return -1;
+        if (m_size > other.m_size) return +1;
+        return 0;
+    }
 
-    return str.substr(pos1 == std::string::npos ? 0 : pos1,
-                      pos2 == std::string::npos ? (str.size() - 1) : (pos2 - pos1 + 1));
-}
+private:
+    //! pointer to the referenced characters
+    const char* m_data;
 
-/**
- * Trims the given string only on the left. Removes all characters in the given
- * drop array, which defaults to " ". Returns a copy of the string.
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      new trimmed string
- */
-static inline std::string trim_left(const std::string& str, const std::string& drop = " ")
-{
-    std::string::size_type pos = str.find_first_not_of(drop);
-    if (pos == std::string::npos) return std::string();
+    //! number of referenced characters
+    size_type m_size;
+};
 
-    return str.substr(pos, std::string::npos);
+static inline bool operator == (const string_ref& a, const string_ref& b)
+{
+    return a.size() == b.size() &&
+        (a.size() == 0 || memcmp(a.data(), b.data(), a.size()) == 0);
 }
 
-/**
- * Trims the given string only on the right. Removes all characters in the
- * given drop array, which defaults to " ". Returns a copy of the string.
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      new trimmed string
- */
-static inline std::string trim_right(const std::string& str, const std::string& drop = " ")
+static inline bool operator != (const string_ref& a, const string_ref& b)
 {
-    std::string::size_type pos = str.find_last_not_of(drop);
-    if (pos == std::string::npos) return std::string();
-
-    return str.substr(0, pos + 1);
+    return !(a == b);
 }
 
-/**
- * Trims the given string in-place on the left and right. Removes all
- * characters in the given drop array, which defaults to " ".
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      reference to the modified string
- */
-static inline std::string& trim_inplace(std::string& str, const std::string& drop = " ")
+static inline bool operator < (const string_ref& a, const string_ref& b)
 {
-    std::string::size_type pos = str.find_last_not_of(drop);
-    if (pos != std::string::npos) {
-        str.erase(pos + 1);
-        pos = str.find_first_not_of(drop);
-        if (pos != std::string::npos) str.erase(0, pos);
-    }
-    else
-        str.erase(str.begin(), str.end());
-
-    return str;
+    return a.compare(b) < 0;
 }
 
-/**
- * Trims the given string in-place only on the left. Removes all characters in
- * the given drop array, which defaults to " ".
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      reference to the modified string
- */
-static inline std::string& trim_left_inplace(std::string& str, const std::string &drop = " ")
+static inline bool operator > (const string_ref& a, const string_ref& b)
 {
-    str.erase(0, str.find_first_not_of(drop));
-    return str;
+    return a.compare(b) > 0;
 }
 
-/**
- * Trims the given string in-place only on the right. Removes all characters in
- * the given drop array, which defaults to " ".
- *
- * @param str   string to process
- * @param drop  remove these characters
- * @return      reference to the modified string
- */
-static inline std::string& trim_right_inplace(std::string &str, const std::string &drop = " ")
+static inline bool operator <= (const string_ref& a, const string_ref& b)
 {
-    str.erase(str.find_last_not_of(drop) + 1, std::string::npos);
-    return str;
+    return a.compare(b) <= 0;
 }
 
-// ***                                 ***
-// ***  Upper and Lower Case Functions ***
-// ***                                 ***
-
-/** toupper() functional for std::transform with correct signature. */
-static inline char char_toupper_functional(char c)
+static inline bool operator >= (const string_ref& a, const string_ref& b)
 {
-    return static_cast<char>(std::toupper(c));
+    return a.compare(b) >= 0;
 }
 
-/** tolower() functional for std::transform with correct signature. */
-static inline char char_tolower_functional(char c)
+static inline std::ostream& operator << (std::ostream& os, const string_ref& s)
 {
-    return static_cast<char>(std::tolower(c));
+    return os.write(s.data(), static_cast<std::streamsize>(s.size()));
 }
 
+// ***                           ***
+// *** Character Scanning Engine ***
+// ***                           ***
+
+/*
+ * The split and trim functions search for separator characters using the
+ * following scanning kernels. On x86 with GCC or clang, SSE2, AVX2 and
+ * AVX-512BW variants compare 16, 32 or 64 bytes at once and locate the first
+ * hit with a bit scan on the comparison mask. The best kernel set is selected
+ * at runtime by CPU feature detection.
+ */
+
 /**
- * Returns a copy of the given string converted to uppercase.
- *
- * @param str   string to process
- * @return      new string uppercased
+ * Test if the character is a whitespace as used by split_ws() and
+ * contains_word(): space, tab, newline or carriage-return.
  */
-static inline std::string toupper(const std::string& str)
+static inline bool is_split_ws(char c)
 {
-    std::string strcopy(str.size(), 0);
-    std::transform(str.begin(), str.end(), strcopy.begin(), char_toupper_functional);
-    return strcopy;
+    return (c == ' ' || c == '\n' || c == '\t' || c == '\r');
 }
 
 /**
- * Returns a copy of the given string converted to lowercase.
- *
- * @param str   string to process
- * @return      new string lowercased
+ * Precompiled set of characters, e.g. of delimiters for split_any(). The set
+ * is stored as a 256-bit bitmap for scalar classification, and as two pairs of
+ * nibble lookup tables used by the SIMD kernels: a byte (h << 4 | l) is in the
+ * set if (lo[l] & (1 << h)) for h < 8, or (lo_high[l] & (1 << (h - 8))) for h
+ * >= 8.
  */
-static inline std::string tolower(const std::string& str)
+class char_set
 {
-    std::string strcopy(str.size(), 0);
-    std::transform(str.begin(), str.end(), strcopy.begin(), char_tolower_functional);
-    return strcopy;
-}
+public:
+    //! construct an empty set
+    char_set()
+    {
+        clear();
+    }
+
+    //! construct a set containing the given characters
+    char_set(const char* chars)
+    {
+        clear();
+        insert(string_ref(chars));
+    }
+
+    //! construct a set containing the given characters
+    char_set(const std::string& chars)
+    {
+        clear();
+        insert(string_ref(chars));
+    }
+
+    //! construct a set containing the given characters
+    char_set(const string_ref& chars)
+    {
+        clear();
+        insert(chars);
+    }
+
+    //! remove all characters from the set
+    void clear()
+    {
+        memset(m_bits, 0, sizeof(m_bits));
+        memset(m_nibble_lo, 0, sizeof(m_nibble_lo));
+        memset(m_nibble_lo_high, 0, sizeof(m_nibble_lo_high));
+    }
+
+    //! add a character to the set
+    char_set& insert(char c)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        m_bits[u >> 5] |= 1u << (u & 31);
+
+        if (u < 0x80)
+            m_nibble_lo[u & 0x0F] |= static_cast<unsigned char>(1 << (u >> 4));
+        else
+            m_nibble_lo_high[u & 0x0F] |= static_cast<unsigned char>(1 << ((u >> 4) - 8));
+
+        return *this;
+    }
+
+    //! add all given characters to the set
+    char_set& insert(const string_ref& chars)
+    {
+        for (string_ref::const_iterator it = chars.begin(); it != chars.end(); ++it)
+            insert(*it);
+        return *this;
+    }
+
+    //! test if the character is contained in the set
+    bool contains(char c) const
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        return (m_bits[u >> 5] >> (u & 31)) & 1;
+    }
+
+    //! nibble lookup table for characters 0x00 - 0x7F
+    const unsigned char* nibble_lo() const { return m_nibble_lo; }
+
+    //! nibble lookup table for characters 0x80 - 0xFF
+    const unsigned char* nibble_lo_high() const { return m_nibble_lo_high; }
+
+private:
+    //! 256-bit membership bitmap
+    unsigned int m_bits[8];
+
+    //! nibble lookup tables indexed by the low four bits of a character
+    unsigned char m_nibble_lo[16], m_nibble_lo_high[16];
+};
 
 /**
- * Transforms the given string to uppercase and returns a reference to it.
- *
- * @param str   string to process
- * @return      reference to the modified string
+ * Byte translation table mapping each of the 256 byte values to a
+ * replacement, like the tr utility. The table is organized in 16 rows of 16
+ * bytes indexed by the high nibble, and a bitmask records the rows which are
+ * not the identity, hence the SIMD kernels only look up those rows.
  */
-static inline std::string& toupper_inplace(std::string& str)
+class byte_map
 {
-    std::transform(str.begin(), str.end(), str.begin(), char_toupper_functional);
-    return str;
+public:
+    //! construct the identity mapping
+    byte_map()
+        : m_rows(0)
+    {
+        for (unsigned int i = 0; i < 256; ++i)
+            m_table[i] = static_cast<unsigned char>(i);
+    }
+
+    //! construct the identity mapping, except for from[i] mapping to to[i]
+    byte_map(const string_ref& from, const string_ref& to)
+        : m_rows(0)
+    {
+        for (unsigned int i = 0; i < 256; ++i)
+            m_table[i] = static_cast<unsigned char>(i);
+        set(from, to);
+    }
+
+    //! map character from to character to
+    byte_map& set(char from, char to)
+    {
+        unsigned char u = static_cast<unsigned char>(from);
+        m_table[u] = static_cast<unsigned char>(to);
+
+        unsigned int row = u >> 4;
+        m_rows &= ~(1u << row);
+        for (unsigned int i = row << 4; i < (row + 1) << 4; ++i) {
+            if (m_table[i] != i) m_rows |= 1u << row;
+        }
+        return *this;
+    }
+
+    /**
+     * Map each character from[i] to to[i]. If to is shorter than from, the
+     * remaining characters are mapped to the last character of to, as tr
+     * does. If to is empty, the mapping is unchanged.
+     */
+    byte_map& set(const string_ref& from, const string_ref& to)
+    {
+        if (to.empty()) return *this;
+
+        for (string_ref::size_type i = 0; i < from.size(); ++i)
+            set(from[i], to[i < to.size() ? i : to.size() - 1]);
+        return *this;
+    }
+
+    //! return the replacement of the character
+    char operator () (char c) const
+    {
+        return static_cast<char>(m_table[static_cast<unsigned char>(c)]);
+    }
+
+    //! 256 byte translation table
+    const unsigned char* table() const { return m_table; }
+
+    //! bitmask of the rows of 16 bytes which are not the identity
+    unsigned int rows() const { return m_rows; }
+
+private:
+    //! translation table
+    unsigned char m_table[256];
+
+    //! bitmask of non-identity rows
+    unsigned int m_rows;
+};
+
+// *** Scalar Kernels ***
+
+/** Return pointer to first c in [p,end), or end if none is found. */
+static inline const char* scan_char_scalar(const char* p, const char* end, char c)
+{
+    for (; p != end; ++p) {
+        if (*p == c) return p;
+    }
+    return end;
 }
 
-/**
- * Transforms the given string to lowercase and returns a reference to it.
- *
- * @param str   string to process
- * @return      reference to the modified string
- */
-static inline std::string& tolower_inplace(std::string& str)
+/** Return pointer to first whitespace in [p,end), or end if none is found. */
+static inline const char* scan_ws_scalar(const char* p, const char* end)
 {
-    std::transform(str.begin(), str.end(), str.begin(), char_tolower_functional);
-    return str;
+    for (; p != end; ++p) {
+        if (is_split_ws(*p)) return p;
+    }
+    return end;
 }
 
-// ***                              ***
-// *** Case-insensitive Comparision ***
-// ***                              ***
+/** Return pointer to first non-whitespace in [p,end), or end if none is found. */
+static inline const char* scan_not_ws_scalar(const char* p, const char* end)
+{
+    for (; p != end; ++p) {
+        if (!is_split_ws(*p)) return p;
+    }
+    return end;
+}
 
-/**
- * Binary class functional which compares two characters
- * case-insensitively. Returns true if they are equal.
- */
-struct char_icase_equal : public std::binary_function<char, char, bool>
+/** Return pointer to first character in [p,end) contained in the set. */
+static inline const char* scan_set_scalar(const char* p, const char* end, const char_set& set)
 {
-    bool operator() (const char& c1, const char& c2) const
-    { return std::tolower(c1) == std::tolower(c2); }
-};
+    for (; p != end; ++p) {
+        if (set.contains(*p)) return p;
+    }
+    return end;
+}
+
+/** Return pointer to first character in [p,end) not contained in the set. */
+static inline const char* scan_not_set_scalar(const char* p, const char* end, const char_set& set)
+{
+    for (; p != end; ++p) {
+        if (!set.contains(*p)) return p;
+    }
+    return end;
+}
 
 /**
- * Binary class functional which compares two characters
- * case-insensitively. Returns true if the first is less than the second.
+ * Return pointer beyond the last character in [p,end) not contained in the
+ * set, or p if all characters are contained in it.
  */
-struct char_icase_less : public std::binary_function<char, char, bool>
+static inline const char* scan_not_set_reverse_scalar(const char* p, const char* end, const char_set& set)
 {
-    bool operator() (const char& c1, const char& c2) const
-    { return std::tolower(c1) < std::tolower(c2); }
-};
+    for (; end != p; --end) {
+        if (!set.contains(end[-1])) return end;
+    }
+    return p;
+}
 
-/**
- * Compare two strings case-insensitively. Return true if they are equal.
+/*
+ * The quote-aware CSV splitter classifies blocks of 64 bytes at once: the
+ * kernels build bitmasks of the quote and separator characters in the block,
+ * and the quoted regions are derived from the quote mask by a prefix XOR,
+ * which sets all bits from an opening quote up to the closing one. The
+ * quoting state at the end of the block is carried into the next one.
  */
-static inline bool equal_icase(const std::string& a, const std::string& b)
+
+/** Return the index of the lowest set bit of x, which must be non-zero. */
+static inline unsigned int scan_ctz64(unsigned long long x)
 {
-    if (a.size() != b.size()) return false;
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned int>(__builtin_ctzll(x));
+#else
+    unsigned int i = 0;
+    while (!(x & 1)) { x >>= 1; ++i; }
+    return i;
+#endif
+}
 
-    return std::equal( a.begin(), a.end(), b.begin(),
-                       char_icase_equal() );
+/** Return the prefix XOR of x: bit i is the parity of the bits 0..i of x. */
+static inline unsigned long long scan_prefix_xor_scalar(unsigned long long x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
 }
 
 /**
- * Compare two string case-insensitively. Return true if this one is less than
- * the other.
+ * Return the mask of separators outside of quoted regions, given the prefix
+ * XOR of the quote mask and the separator mask of a 64 byte block. The
+ * quoting state carried over is updated to all ones if the block ends inside
+ * quotes, and to zero otherwise.
  */
-static inline bool less_icase(const std::string& a, const std::string& b)
+static inline unsigned long long scan_csv_finish(unsigned long long quotes_prefix, unsigned long long seps, unsigned long long& quoted)
 {
-    return std::lexicographical_compare( a.begin(), a.end(),
-                                         b.begin(), b.end(),
-                                         char_icase_less() );
+    unsigned long long inside = quotes_prefix ^ quoted;
+    quoted = 0 - (inside >> 63);
+    return seps & ~inside;
 }
 
 /**
- * Compare two string case-insensitively. Returns 0 if they are equal, -1 if a
- * is lexicographical before b, +1 if a is after b.
+ * Return the mask of separators outside of quoted regions in the 64 bytes
+ * starting at p.
  */
-static inline int compare_icase(const std::string& a, const std::string& b)
+static inline unsigned long long scan_csv_block_scalar(const char* p, char sep, unsigned long long& quoted)
 {
-    std::string::const_iterator ai = a.begin();
-    std::string::const_iterator bi = b.begin();
+    unsigned long long quotes = 0, seps = 0;
+    for (unsigned int i = 0; i < 64; ++i) {
+        quotes |= static_cast<unsigned long long>(p[i] == '"') << i;
+        seps |= static_cast<unsigned long long>(p[i] == sep) << i;
+    }
+    return scan_csv_finish(scan_prefix_xor_scalar(quotes), seps, quoted);
+}
 
-    while( ai != a.end() && bi != b.end() )
-    {
-        int ca = std::tolower(*ai++);
-        int cb = std::tolower(*bi++);
+/*
+ * The ASCII case mapping kernels flip the 0x20 bit of all bytes in the range
+ * [first,first+26), which is 'a'-'z' for uppercasing and 'A'-'Z' for
+ * lowercasing. They write to out, which may be equal to p.
+ */
 
-        if (ca == cb) continue;
-        if (ca < cb) return -1;
-        else return +1;
+static inline void scan_map_case_scalar(const char* p, const char* end, char* out, char first)
+{
+    for (; p != end; ++p, ++out) {
+        unsigned char d = static_cast<unsigned char>(*p - first);
+        *out = (d < 26) ? static_cast<char>(*p ^ 0x20) : *p;
     }
+}
 
-    if (ai == a.end() && bi != b.end()) return +1;
-    else if (ai != a.end() && bi == b.end()) return -1;
-    else return 0;
+/** Convert an ASCII uppercase letter to lowercase, other bytes unchanged. */
+static inline char scan_fold_ascii(char c)
+{
+    return (static_cast<unsigned char>(c - 'A') < 26) ? static_cast<char>(c | 0x20) : c;
 }
 
 /**
- * Case-sensitive less order relation functional class for std::map.
+ * Compare n bytes at a and b with ASCII letters folded to lowercase. Returns
+ * the index of the first mismatching byte, or n.
  */
-struct order_less
+static inline size_t scan_mismatch_icase_scalar(const char* a, const char* b, size_t n)
 {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return (a < b);
+    for (size_t i = 0; i < n; ++i) {
+        if (scan_fold_ascii(a[i]) != scan_fold_ascii(b[i])) return i;
     }
-};
+    return n;
+}
 
-/**
- * Case-insensitive less order relation functional class for std::map.
- */
-struct order_less_icase
+/** Return pointer to the first byte >= 0x80 in [p,end), or end. */
+static inline const char* scan_non_ascii_scalar(const char* p, const char* end)
 {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return less_icase(a, b);
+    for (; p != end; ++p) {
+        if (*p & 0x80) return p;
     }
-};
+    return end;
+}
 
-/**
- * Descending case-sensitive less order relation functional class for
- * std::map.
+/*
+ * The substring searches prefilter candidate positions q by the first and
+ * the last needle byte: the kernels return the first q in [p,end) with q[0]
+ * and q[offset] equal to first and last, the icase variants after folding
+ * ASCII letters to lowercase. The bytes up to end - 1 + offset must be
+ * readable.
  */
-struct order_less_desc
+
+static inline const char* scan_pair_icase_scalar(const char* p, const char* end, char first, char last, size_t offset)
 {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return !(a < b);
+    for (; p != end; ++p) {
+        if (scan_fold_ascii(p[0]) == first && scan_fold_ascii(p[offset]) == last)
+            return p;
     }
-};
+    return end;
+}
 
-/**
- * Descending case-insensitive less order relation functional class for
- * std::map.
- */
-struct order_less_icase_desc
+static inline const char* scan_pair_scalar(const char* p, const char* end, char first, char last, size_t offset)
 {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return !less_icase(a, b);
+    for (; p != end; ++p) {
+        if (p[0] == first && p[offset] == last) return p;
     }
-};
+    return end;
+}
 
-// ***                                        ***
-// *** String Stream Transformation Functions ***
-// ***                                        ***
+/** Translate all bytes in [p,end) using the map and write them to out. */
+static inline void scan_translate_scalar(const char* p, const char* end, char* out, const byte_map& map)
+{
+    const unsigned char* table = map.table();
+    for (; p != end; ++p, ++out)
+        *out = static_cast<char>(table[static_cast<unsigned char>(*p)]);
+}
 
-/**
- * Template transformation function which uses std::ostringstream to serialize
- * any ostreamable type into a std::string.
- */
-template <typename Type>
-static inline std::string to_str(const Type& val)
+#if STX_STRING_X86_SIMD
+
+// *** SSE2 Kernels ***
+
+/** Return mask of whitespace bytes in the 16 byte vector. */
+__attribute__((target("sse2")))
+static inline unsigned int scan_ws_mask_sse2(__m128i v)
 {
-    std::ostringstream os;
-    os << val;
-    return os.str();
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    return static_cast<unsigned int>(_mm_movemask_epi8(m));
 }
 
-/**
- * Template transformation function which uses std::istringstream to parse any
- * istreamable type from a std::string.
- */
-template <typename Type>
-static inline bool from_str(const std::string& str, Type& outval)
+__attribute__((target("sse2")))
+static inline const char* scan_char_sse2(const char* p, const char* end, char c)
 {
-    std::istringstream is(str);
-    is >> outval;
-    return is.eof();
+    const __m128i vc = _mm_set1_epi8(c);
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_char_scalar(p, end, c);
 }
 
-// ***                             ***
-// *** Prefix and Suffix Functions ***
-// ***                             ***
-
-/**
- * Checks if the given match string is located at the start of this string.
- */
-static inline bool is_prefix(const std::string& str, const std::string& match)
+__attribute__((target("sse2")))
+static inline const char* scan_ws_sse2(const char* p, const char* end)
 {
-    if (match.size() > str.size()) return false;
-    return std::equal( match.begin(), match.end(), str.begin() );
+    for (; end - p >= 16; p += 16) {
+        unsigned int mask = scan_ws_mask_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_ws_scalar(p, end);
 }
 
-/**
- * Checks if the given match string is located at the end of this string.
- */
-static inline bool is_suffix(const std::string& str, const std::string& match)
+__attribute__((target("sse2")))
+static inline const char* scan_not_ws_sse2(const char* p, const char* end)
 {
-    if (match.size() > str.size()) return false;
-    return std::equal( match.begin(), match.end(),
-                       str.end() - match.size() );
+    for (; end - p >= 16; p += 16) {
+        unsigned int mask = ~scan_ws_mask_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFF;
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_not_ws_scalar(p, end);
 }
 
-/**
- * Checks if the given match string is located at the start of this
- * string. Compares the characters case-insensitively.
- */
-static inline bool is_prefix_icase(const std::string& str, const std::string& match)
+__attribute__((target("sse2")))
+static inline unsigned long long scan_csv_block_sse2(const char* p, char sep, unsigned long long& quoted)
 {
-    if (match.size() > str.size()) return false;
-    return std::equal( match.begin(), match.end(), str.begin(),
-                       char_icase_equal() );
+    const __m128i vq = _mm_set1_epi8('"'), vs = _mm_set1_epi8(sep);
+    unsigned long long quotes = 0, seps = 0;
+    for (unsigned int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        quotes |= static_cast<unsigned long long>(static_cast<unsigned int>(
+                      _mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)))) << i;
+        seps |= static_cast<unsigned long long>(static_cast<unsigned int>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(v, vs)))) << i;
+    }
+    return scan_csv_finish(scan_prefix_xor_scalar(quotes), seps, quoted);
 }
 
-/**
- * Checks if the given match string is located at the end of this
- * string. Compares the characters case-insensitively.
- */
-static inline bool is_suffix_icase(const std::string& str, const std::string& match)
+__attribute__((target("sse2")))
+static inline void scan_map_case_sse2(const char* p, const char* end, char* out, char first)
 {
-    if (match.size() > str.size()) return false;
-    return std::equal( match.begin(), match.end(),
-                       str.end() - match.size(),
-                       char_icase_equal() );
+    // bytes in [first,first+26) are shifted to [-128,-102) for a signed compare
+    const __m128i shift = _mm_set1_epi8(static_cast<char>(0x80 - first));
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    const __m128i flip = _mm_set1_epi8(0x20);
+    for (; end - p >= 16; p += 16, out += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_cmpgt_epi8(limit, _mm_add_epi8(v, shift));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_xor_si128(v, _mm_and_si128(m, flip)));
+    }
+    scan_map_case_scalar(p, end, out, first);
 }
 
-// ***                              ***
-// *** Search and Replace Functions ***
-// ***                              ***
-
-/**
- * Replace only the first occurrence of needle in str. The needle will be
- * replaced with instead, if found. Returns a copy of the string with the
- * possible replacement.
- *
- * @param str           the string to process
- * @param needle        string to search for in str
- * @param instead       replace needle with instead
- * @return              copy of string possibly with replacement
- */
-static inline std::string replace_first(const std::string& str, const std::string& needle, const std::string& instead)
+/** Fold the ASCII uppercase letters in the 16 byte vector to lowercase. */
+__attribute__((target("sse2")))
+static inline __m128i scan_fold_ascii_sse2(__m128i v)
 {
-    std::string newstr = str;
-    std::string::size_type firstpos = newstr.find(needle);
+    __m128i m = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26),
+                               _mm_add_epi8(v, _mm_set1_epi8(0x80 - 'A')));
+    return _mm_or_si128(v, _mm_and_si128(m, _mm_set1_epi8(0x20)));
+}
 
-    if ( firstpos != std::string::npos)
-        newstr.replace(firstpos, needle.size(), instead);
+__attribute__((target("sse2")))
+static inline size_t scan_mismatch_icase_sse2(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m128i va = scan_fold_ascii_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m128i vb = scan_fold_ascii_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        unsigned int mask = ~static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xFFFF;
+        if (mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + scan_mismatch_icase_scalar(a + i, b + i, n - i);
+}
 
-    return newstr;
+__attribute__((target("sse2")))
+static inline const char* scan_non_ascii_sse2(const char* p, const char* end)
+{
+    for (; end - p >= 16; p += 16) {
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_non_ascii_scalar(p, end);
 }
 
-/**
- * Replace all occurrences of needle in str. Each needle will be replaced with
- * instead, if found. Returns a copy of the string with possible replacements.
- *
- * @param str           the string to process
- * @param needle        string to search for in str
- * @param instead       replace needle with instead
- * @return              copy of string possibly with replacements
- */
-static inline std::string replace_all(const std::string& str, const std::string& needle, const std::string& instead)
+__attribute__((target("sse2")))
+static inline const char* scan_pair_icase_sse2(const char* p, const char* end, char first, char last, size_t offset)
 {
-    std::string newstr = str;
-    std::string::size_type lastpos = 0, thispos;
+    const __m128i vf = _mm_set1_epi8(first), vl = _mm_set1_epi8(last);
+    for (; end - p >= 16; p += 16) {
+        __m128i v0 = scan_fold_ascii_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        __m128i v1 = scan_fold_ascii_sse2(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + offset)));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v0, vf), _mm_cmpeq_epi8(v1, vl))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_pair_icase_scalar(p, end, first, last, offset);
+}
 
-    while ( (thispos = newstr.find(needle, lastpos)) != std::string::npos)
-    {
-        newstr.replace(thispos, needle.size(), instead);
-        lastpos = thispos + instead.size();
+__attribute__((target("sse2")))
+static inline const char* scan_pair_sse2(const char* p, const char* end, char first, char last, size_t offset)
+{
+    const __m128i vf = _mm_set1_epi8(first), vl = _mm_set1_epi8(last);
+    for (; end - p >= 16; p += 16) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + offset));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v0, vf), _mm_cmpeq_epi8(v1, vl))));
+        if (mask) return p + __builtin_ctz(mask);
     }
-    return newstr;
+    return scan_pair_scalar(p, end, first, last, offset);
 }
 
 /**
- * Replace only the first occurrence of needle in str. The needle will be
- * replaced with instead, if found. The replacement is done in the given string
- * and a reference to the same is returned.
- *
- * @param str           the string to process
- * @param needle        string to search for in str
- * @param instead       replace needle with instead
- * @return              reference to str
+ * Return the prefix XOR of x computed by a carry-less multiplication with all
+ * ones.
  */
-static inline std::string& replace_first_inplace(std::string& str, const std::string& needle, const std::string& instead)
+__attribute__((target("sse2,pclmul")))
+static inline unsigned long long scan_prefix_xor_clmul(unsigned long long x)
 {
-    std::string::size_type firstpos = str.find(needle);
+    unsigned long long out;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&out), _mm_clmulepi64_si128(
+                         _mm_set_epi64x(0, static_cast<long long>(x)),
+                         _mm_set1_epi8(-1), 0));
+    return out;
+}
 
-    if ( firstpos != std::string::npos)
-        str.replace(firstpos, needle.size(), instead);
+// *** AVX2 Kernels ***
 
-    return str;
+/** Return mask of whitespace bytes in the 32 byte vector. */
+__attribute__((target("avx2")))
+static inline unsigned int scan_ws_mask_avx2(__m256i v)
+{
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    return static_cast<unsigned int>(_mm256_movemask_epi8(m));
 }
 
-/**
- * Replace all occurrences of needle in str. Each needle will be replaced with
- * instead, if found. The replacement is done in the given string and a
- * reference to the same is returned.
- *
- * @param str           the string to process
- * @param needle        string to search for in str
- * @param instead       replace needle with instead
- * @return              reference to str
- */
-static inline std::string& replace_all_inplace(std::string& str, const std::string& needle, const std::string& instead)
+__attribute__((target("avx2")))
+static inline const char* scan_char_avx2(const char* p, const char* end, char c)
 {
-    std::string::size_type lastpos = 0, thispos;
+    const __m256i vc = _mm256_set1_epi8(c);
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_char_sse2(p, end, c);
+}
 
-    while ( (thispos = str.find(needle, lastpos)) != std::string::npos)
-    {
-        str.replace(thispos, needle.size(), instead);
-        lastpos = thispos + instead.size();
+__attribute__((target("avx2")))
+static inline const char* scan_ws_avx2(const char* p, const char* end)
+{
+    for (; end - p >= 32; p += 32) {
+        unsigned int mask = scan_ws_mask_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (mask) return p + __builtin_ctz(mask);
     }
-    return str;
+    return scan_ws_sse2(p, end);
 }
 
-// ***                                ***
-// *** Extract and Contains Functions ***
-// ***                                ***
+__attribute__((target("avx2")))
+static inline const char* scan_not_ws_avx2(const char* p, const char* end)
+{
+    for (; end - p >= 32; p += 32) {
+        unsigned int mask = ~scan_ws_mask_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_not_ws_sse2(p, end);
+}
 
 /**
- * Search for a substring like find() but case-insensitively.
- *
- * @param haystack      string to search in
- * @param pos           position to start search
- * @param needle        string to search for
- * @param needlelen     length of search string
+ * Return mask of the bytes in the 32 byte vector contained in the character
+ * set, by looking up both nibbles of each byte with vpshufb.
  */
-static inline std::string::size_type find_icase(const std::string& haystack, const char* needle, std::string::size_type pos, std::string::size_type needlelen)
+__attribute__((target("avx2")))
+static inline unsigned int scan_set_mask_avx2(__m256i v, const char_set& set)
 {
-    if (needlelen == 0)
-        return (pos <= haystack.size()) ? pos : std::string::npos;
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.nibble_lo())));
+    const __m256i lo_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.nibble_lo_high())));
+    const __m256i hi = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i hi_high = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128,
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i nlo = _mm256_and_si256(v, nibble);
+    __m256i nhi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+
+    __m256i m = _mm256_or_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(lo, nlo),
+                         _mm256_shuffle_epi8(hi, nhi)),
+        _mm256_and_si256(_mm256_shuffle_epi8(lo_high, nlo),
+                         _mm256_shuffle_epi8(hi_high, nhi)));
+
+    return ~static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(m, _mm256_setzero_si256())));
+}
 
-    for (; pos <= haystack.size() - needlelen; ++pos)
-    {
-        if (std::equal( needle, needle + needlelen, haystack.data() + pos,
-                        char_icase_equal() ))
-        {
-            return pos;
-        }
+__attribute__((target("avx2")))
+static inline const char* scan_set_avx2(const char* p, const char* end, const char_set& set)
+{
+    for (; end - p >= 32; p += 32) {
+        unsigned int mask = scan_set_mask_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), set);
+        if (mask) return p + __builtin_ctz(mask);
     }
-    return std::string::npos;
+    return scan_set_scalar(p, end, set);
 }
 
-/**
- * Search for a substring like find() but case-insensitively.
- *
- * @param haystack      string to search in
- * @param pos           position to start search
- * @param needle        string to search for
- */
-static inline std::string::size_type find_icase(const std::string& haystack, const std::string& needle, std::string::size_type pos = 0)
+__attribute__((target("avx2")))
+static inline const char* scan_not_set_avx2(const char* p, const char* end, const char_set& set)
 {
-    return find_icase(haystack, needle.data(), pos, needle.size());
+    for (; end - p >= 32; p += 32) {
+        unsigned int mask = ~scan_set_mask_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), set);
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_not_set_scalar(p, end, set);
 }
 
-/**
- * Search the given string for a whitespace-delimited word. It works as if the
- * str was split_ws() and the resulting vector checked for a given
- * word. However this function does not create a vector, it scans the string
- * directly. Whitespace is space, tab, newline or carriage-return.
- *
- * @param str   whitespace-delimited string to check
- * @param word  word to find
- * @return      true if the word was found
- */
-static inline bool contains_word(const std::string& str, const std::string& word)
+__attribute__((target("avx2")))
+static inline const char* scan_not_set_reverse_avx2(const char* p, const char* end, const char_set& set)
 {
-    std::string::const_iterator it = str.begin(), last = it;
+    for (; end - p >= 32; end -= 32) {
+        unsigned int mask = ~scan_set_mask_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end - 32)), set);
+        if (mask) return end - __builtin_clz(mask);
+    }
+    return scan_not_set_reverse_scalar(p, end, set);
+}
 
-    while (it != str.end())
-    {
-        // skip over whitespace
-        while (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r') {
-            if (++it == str.end()) return false;
-        }
-
-        // check if this non-whitespace matches the string
-        std::string::const_iterator wi = word.begin();
-        while (*it == *wi) {
-            ++it; ++wi;
-            if (wi == word.end()) {
-                if (it == str.end() || *it == ' ' || *it == '\n' || *it == '\t' || *it == '\r')
-                    return true;
-                else break;
-            }
-            if (it == str.end()) return false;
-        }
+__attribute__((target("avx2,pclmul")))
+static inline unsigned long long scan_csv_block_avx2(const char* p, char sep, unsigned long long& quoted)
+{
+    const __m256i vq = _mm256_set1_epi8('"'), vs = _mm256_set1_epi8(sep);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+
+    unsigned long long quotes =
+        static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vq))) |
+        static_cast<unsigned long long>(static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vq)))) << 32;
+    unsigned long long seps =
+        static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vs))) |
+        static_cast<unsigned long long>(static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vs)))) << 32;
+
+    return scan_csv_finish(scan_prefix_xor_clmul(quotes), seps, quoted);
+}
 
-        // skip over not matching whitespace
-        while (*it != ' ' && *it != '\n' && *it != '\t' && *it != '\r') {
-            if (++it == str.end()) return false;
-        }
+__attribute__((target("avx2")))
+static inline void scan_map_case_avx2(const char* p, const char* end, char* out, char first)
+{
+    const __m256i shift = _mm256_set1_epi8(static_cast<char>(0x80 - first));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    for (; end - p >= 32; p += 32, out += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_xor_si256(v, _mm256_and_si256(m, flip)));
     }
-
-    return false;
+    scan_map_case_scalar(p, end, out, first);
 }
 
-/**
- * Search the string for given start and end separators and extract all
- * characters between the both, if they are found. Otherwise return an empty
- * string.
- *
- * @param str   string to search in
- * @param sep1  start boundary
- * @param sep2  end boundary
- */
-static inline std::string extract_between(const std::string& str,
-                                          const std::string& sep1,
-                                          const std::string& sep2)
+/** Fold the ASCII uppercase letters in the 32 byte vector to lowercase. */
+__attribute__((target("avx2")))
+static inline __m256i scan_fold_ascii_avx2(__m256i v)
 {
-    std::string::size_type start = str.find(sep1);
-    if (start == std::string::npos)
-        return std::string();
+    __m256i m = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26),
+                                  _mm256_add_epi8(v, _mm256_set1_epi8(0x80 - 'A')));
+    return _mm256_or_si256(v, _mm256_and_si256(m, _mm256_set1_epi8(0x20)));
+}
 
-    start += sep1.length();
+__attribute__((target("avx2")))
+static inline size_t scan_mismatch_icase_avx2(const char* a, const char* b, size_t n)
+{
+    size_t i = 0;
+    for (; n - i >= 32; i += 32) {
+        __m256i va = scan_fold_ascii_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+        __m256i vb = scan_fold_ascii_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        unsigned int mask = ~static_cast<unsigned int>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+        if (mask) return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+    return i + scan_mismatch_icase_sse2(a + i, b + i, n - i);
+}
 
-    std::string::size_type limit = str.find(sep2, start);
+__attribute__((target("avx2")))
+static inline const char* scan_non_ascii_avx2(const char* p, const char* end)
+{
+    for (; end - p >= 32; p += 32) {
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_non_ascii_sse2(p, end);
+}
 
-    if (limit == std::string::npos)
-        return std::string();
+__attribute__((target("avx2")))
+static inline const char* scan_pair_icase_avx2(const char* p, const char* end, char first, char last, size_t offset)
+{
+    const __m256i vf = _mm256_set1_epi8(first), vl = _mm256_set1_epi8(last);
+    for (; end - p >= 32; p += 32) {
+        __m256i v0 = scan_fold_ascii_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        __m256i v1 = scan_fold_ascii_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + offset)));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v0, vf), _mm256_cmpeq_epi8(v1, vl))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_pair_icase_sse2(p, end, first, last, offset);
+}
 
-    return str.substr(start, limit - start);
+__attribute__((target("avx2")))
+static inline const char* scan_pair_avx2(const char* p, const char* end, char first, char last, size_t offset)
+{
+    const __m256i vf = _mm256_set1_epi8(first), vl = _mm256_set1_epi8(last);
+    for (; end - p >= 32; p += 32) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + offset));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v0, vf), _mm256_cmpeq_epi8(v1, vl))));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_pair_sse2(p, end, first, last, offset);
 }
 
 /**
- * Search the string for given start and end separators and extract all
- * characters between the both, if they are found. Otherwise return an empty
- * string. Ignore case while searching.
- *
- * @param str   string to search in
- * @param sep1  start boundary
- * @param sep2  end boundary
+ * Translate 32 bytes at once: each non-identity row of the table is looked up
+ * with vpshufb by the low nibbles and blended into the bytes whose high
+ * nibble selects the row.
  */
-static inline std::string extract_between_icase(const std::string& str,
-                                                const std::string& sep1,
-                                                const std::string& sep2)
+__attribute__((target("avx2")))
+static inline void scan_translate_avx2(const char* p, const char* end, char* out, const byte_map& map)
 {
-    std::string::size_type start = find_icase(str, sep1);
-    if (start == std::string::npos)
-        return std::string();
-
-    start += sep1.length();
-
-    std::string::size_type limit = find_icase(str, sep2, start);
-
-    if (start == std::string::npos)
-        return std::string();
+    __m256i row[16], row_id[16];
+    unsigned int nrows = 0;
+    for (unsigned int m = map.rows(); m != 0; m &= m - 1) {
+        unsigned int h = static_cast<unsigned int>(__builtin_ctz(m));
+        row[nrows] = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+                         reinterpret_cast<const __m128i*>(map.table() + 16 * h)));
+        row_id[nrows++] = _mm256_set1_epi8(static_cast<char>(h));
+    }
 
-    return str.substr(start, limit - start);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    for (; end - p >= 32; p += 32, out += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        for (unsigned int i = 0; i < nrows; ++i) {
+            v = _mm256_blendv_epi8(v, _mm256_shuffle_epi8(row[i], lo),
+                                   _mm256_cmpeq_epi8(hi, row_id[i]));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+    }
+    scan_translate_scalar(p, end, out, map);
 }
 
+#if STX_STRING_X86_AVX512
 
-// ***                          ***
-// *** Split and Join Functions ***
-// ***                          ***
+// *** AVX-512BW Kernels ***
 
-/**
- * Split the given string by whitespaces into distinct words. Multiple
- * consecutive whitespaces are considered as one split point. Whitespaces are
- * space, tab, newline and carriage-return.
- *
- * @param str   string to split
- * @param limit maximum number of parts returned
- * @return      vector containing each split substring
+/*
+ * The AVX-512 kernels process the tail of the range with a masked load, which
+ * does not touch the bytes beyond end.
  */
-static inline std::vector<std::string> split_ws(const std::string& str, std::string::size_type limit = std::string::npos)
-{
-    std::vector<std::string> out;
-    if (limit == 0) return out;
 
-    std::string::const_iterator it = str.begin(), last = it;
-
-    for (; it != str.end(); ++it)
-    {
-        if (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r')
-        {
-            if (it == last) { // skip over empty split substrings
-                last = it+1;
-                continue;
-            }
+/** Return mask of the first n < 64 bytes. */
+static inline __mmask64 scan_tail_mask_avx512(const char* p, const char* end)
+{
+    return static_cast<__mmask64>(
+        (static_cast<unsigned long long>(1) << (end - p)) - 1);
+}
 
-            if (out.size() + 1 >= limit)
-            {
-                out.push_back(std::string(last, str.end()));
-                return out;
-            }
+/** Return mask of whitespace bytes in the 64 byte vector. */
+__attribute__((target("avx512bw")))
+static inline __mmask64 scan_ws_mask_avx512(__m512i v)
+{
+    return _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' ')) |
+        _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n')) |
+        _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\t')) |
+        _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\r'));
+}
 
-            out.push_back(std::string(last, it));
-            last = it + 1;
-        }
+__attribute__((target("avx512bw")))
+static inline const char* scan_char_avx512(const char* p, const char* end, char c)
+{
+    const __m512i vc = _mm512_set1_epi8(c);
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), vc);
+        if (mask) return p + __builtin_ctzll(mask);
     }
+    if (p == end) return end;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+        tail, _mm512_maskz_loadu_epi8(tail, p), vc);
+    return mask ? p + __builtin_ctzll(mask) : end;
+}
 
-    if (last != it)
-        out.push_back(std::string(last, it));
-
-    return out;
+__attribute__((target("avx512bw")))
+static inline const char* scan_ws_avx512(const char* p, const char* end)
+{
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = scan_ws_mask_avx512(_mm512_loadu_si512(p));
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    if (p == end) return end;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __mmask64 mask = scan_ws_mask_avx512(_mm512_maskz_loadu_epi8(tail, p)) & tail;
+    return mask ? p + __builtin_ctzll(mask) : end;
+}
+
+__attribute__((target("avx512bw")))
+static inline const char* scan_not_ws_avx512(const char* p, const char* end)
+{
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = ~scan_ws_mask_avx512(_mm512_loadu_si512(p));
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    if (p == end) return end;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __mmask64 mask = ~scan_ws_mask_avx512(_mm512_maskz_loadu_epi8(tail, p)) & tail;
+    return mask ? p + __builtin_ctzll(mask) : end;
 }
 
 /**
- * Split the given string at each separator character into distinct
- * substrings. Multiple consecutive separators are considered individually and
- * will result in empty split substrings.
- *
- * @param str   string to split
- * @param sep   separator character
- * @param limit maximum number of parts returned
- * @return      vector containing each split substring
+ * Return mask of the bytes in the 64 byte vector contained in the character
+ * set, by looking up both nibbles of each byte with vpshufb.
  */
-static inline std::vector<std::string> split(const std::string& str, char sep, std::string::size_type limit = std::string::npos)
+__attribute__((target("avx512bw")))
+static inline __mmask64 scan_set_mask_avx512(__m512i v, const char_set& set)
 {
-    std::vector<std::string> out;
-    if (limit == 0) return out;
+    // zero-masking broadcasts, the plain ones trigger -Wmaybe-uninitialized
+    // in GCC's intrinsics headers
+    const __m512i lo = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(set.nibble_lo())));
+    const __m512i lo_high = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(set.nibble_lo_high())));
+    const __m512i hi = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0));
+    const __m512i hi_high = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128));
+    const __m512i nibble = _mm512_set1_epi8(0x0F);
+
+    __m512i nlo = _mm512_and_si512(v, nibble);
+    __m512i nhi = _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble);
+
+    __m512i m = _mm512_or_si512(
+        _mm512_and_si512(_mm512_shuffle_epi8(lo, nlo),
+                         _mm512_shuffle_epi8(hi, nhi)),
+        _mm512_and_si512(_mm512_shuffle_epi8(lo_high, nlo),
+                         _mm512_shuffle_epi8(hi_high, nhi)));
+
+    return _mm512_test_epi8_mask(m, m);
+}
 
-    std::string::const_iterator it = str.begin(), last = it;
+__attribute__((target("avx512bw")))
+static inline const char* scan_set_avx512(const char* p, const char* end, const char_set& set)
+{
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = scan_set_mask_avx512(_mm512_loadu_si512(p), set);
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    if (p == end) return end;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __mmask64 mask = scan_set_mask_avx512(_mm512_maskz_loadu_epi8(tail, p), set) & tail;
+    return mask ? p + __builtin_ctzll(mask) : end;
+}
 
-    for (; it != str.end(); ++it)
-    {
-        if (*it == sep)
-        {
-            if (out.size() + 1 >= limit)
-            {
-                out.push_back(std::string(last, str.end()));
-                return out;
-            }
+__attribute__((target("avx512bw")))
+static inline const char* scan_not_set_avx512(const char* p, const char* end, const char_set& set)
+{
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = ~scan_set_mask_avx512(_mm512_loadu_si512(p), set);
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    if (p == end) return end;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __mmask64 mask = ~scan_set_mask_avx512(_mm512_maskz_loadu_epi8(tail, p), set) & tail;
+    return mask ? p + __builtin_ctzll(mask) : end;
+}
 
-            out.push_back(std::string(last, it));
-            last = it + 1;
-        }
+__attribute__((target("avx512bw")))
+static inline const char* scan_not_set_reverse_avx512(const char* p, const char* end, const char_set& set)
+{
+    for (; end - p >= 64; end -= 64) {
+        __mmask64 mask = ~scan_set_mask_avx512(_mm512_loadu_si512(end - 64), set);
+        if (mask) return end - __builtin_clzll(mask);
     }
+    return scan_not_set_reverse_avx2(p, end, set);
+}
 
-    if (last != it)
-        out.push_back(std::string(last, it));
+__attribute__((target("avx512bw,pclmul")))
+static inline unsigned long long scan_csv_block_avx512(const char* p, char sep, unsigned long long& quoted)
+{
+    __m512i v = _mm512_loadu_si512(p);
+    return scan_csv_finish(
+        scan_prefix_xor_clmul(_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'))),
+        _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(sep)), quoted);
+}
 
-    return out;
+/** Fold the ASCII uppercase letters in the 64 byte vector to lowercase. */
+__attribute__((target("avx512bw")))
+static inline __m512i scan_fold_ascii_avx512(__m512i v)
+{
+    __mmask64 m = _mm512_cmplt_epu8_mask(
+        _mm512_sub_epi8(v, _mm512_set1_epi8('A')), _mm512_set1_epi8(26));
+    return _mm512_mask_blend_epi8(m, v, _mm512_or_si512(v, _mm512_set1_epi8(0x20)));
 }
 
-/**
- * Split the given string at each separator string into distinct
- * substrings. Multiple consecutive separators are considered individually and
- * will result in empty split substrings.
- *
- * @param str           string to split
- * @param sepstr        separator string
- * @param limit         maximum number of parts returned
- * @return              vector containing each split substring
- */
-static inline std::vector<std::string> split(const std::string& str, const std::string& sepstr, std::string::size_type limit = std::string::npos)
+__attribute__((target("avx512bw")))
+static inline size_t scan_mismatch_icase_avx512(const char* a, const char* b, size_t n)
 {
-    std::vector<std::string> out;
-    if (limit == 0) return out;
-    if (sepstr.empty()) return out;
+    size_t i = 0;
+    for (; n - i >= 64; i += 64) {
+        __mmask64 mask = _mm512_cmpneq_epi8_mask(
+            scan_fold_ascii_avx512(_mm512_loadu_si512(a + i)),
+            scan_fold_ascii_avx512(_mm512_loadu_si512(b + i)));
+        if (mask) return i + static_cast<size_t>(__builtin_ctzll(mask));
+    }
+    if (i == n) return n;
+    __mmask64 tail = scan_tail_mask_avx512(a + i, a + n);
+    __mmask64 mask = _mm512_mask_cmpneq_epi8_mask(
+        tail, scan_fold_ascii_avx512(_mm512_maskz_loadu_epi8(tail, a + i)),
+        scan_fold_ascii_avx512(_mm512_maskz_loadu_epi8(tail, b + i)));
+    return mask ? i + static_cast<size_t>(__builtin_ctzll(mask)) : n;
+}
+
+__attribute__((target("avx512bw")))
+static inline const char* scan_non_ascii_avx512(const char* p, const char* end)
+{
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = _mm512_movepi8_mask(_mm512_loadu_si512(p));
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    return scan_non_ascii_avx2(p, end);
+}
 
-    std::string::const_iterator it = str.begin(), last = it;
+__attribute__((target("avx512bw")))
+static inline const char* scan_pair_icase_avx512(const char* p, const char* end, char first, char last, size_t offset)
+{
+    const __m512i vf = _mm512_set1_epi8(first), vl = _mm512_set1_epi8(last);
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+            _mm512_cmpeq_epi8_mask(scan_fold_ascii_avx512(_mm512_loadu_si512(p)), vf),
+            scan_fold_ascii_avx512(_mm512_loadu_si512(p + offset)), vl);
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    return scan_pair_icase_avx2(p, end, first, last, offset);
+}
 
-    for (; it + sepstr.size() < str.end(); ++it)
-    {
-        if (std::equal(sepstr.begin(), sepstr.end(), it))
-        {
-            if (out.size() + 1 >= limit)
-            {
-                out.push_back(std::string(last, str.end()));
-                return out;
-            }
+__attribute__((target("avx512bw")))
+static inline const char* scan_pair_avx512(const char* p, const char* end, char first, char last, size_t offset)
+{
+    const __m512i vf = _mm512_set1_epi8(first), vl = _mm512_set1_epi8(last);
+    for (; end - p >= 64; p += 64) {
+        __mmask64 mask = _mm512_mask_cmpeq_epi8_mask(
+            _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), vf),
+            _mm512_loadu_si512(p + offset), vl);
+        if (mask) return p + __builtin_ctzll(mask);
+    }
+    return scan_pair_avx2(p, end, first, last, offset);
+}
 
-            out.push_back(std::string(last, it));
-            last = it + sepstr.size();
-        }
+__attribute__((target("avx512bw")))
+static inline void scan_map_case_avx512(const char* p, const char* end, char* out, char first)
+{
+    const __m512i vfirst = _mm512_set1_epi8(first);
+    const __m512i limit = _mm512_set1_epi8(26);
+    const __m512i flip = _mm512_set1_epi8(0x20);
+    for (; end - p >= 64; p += 64, out += 64) {
+        __m512i v = _mm512_loadu_si512(p);
+        __mmask64 m = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, vfirst), limit);
+        _mm512_storeu_si512(out, _mm512_mask_blend_epi8(m, v, _mm512_xor_si512(v, flip)));
     }
+    if (p == end) return;
+    __mmask64 tail = scan_tail_mask_avx512(p, end);
+    __m512i v = _mm512_maskz_loadu_epi8(tail, p);
+    __mmask64 m = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, vfirst), limit);
+    _mm512_mask_storeu_epi8(out, tail, _mm512_mask_blend_epi8(m, v, _mm512_xor_si512(v, flip)));
+}
 
-    if (last != str.end())
-        out.push_back(std::string(last, str.end()));
+#endif // STX_STRING_X86_AVX512
 
-    return out;
+#endif // STX_STRING_X86_SIMD
+
+// *** Runtime Kernel Selection ***
+
+/** Instruction set levels of the scanning kernels. */
+enum scan_isa {
+    scan_isa_scalar = 0,
+    scan_isa_sse2 = 1,
+    scan_isa_avx2 = 2,
+    scan_isa_avx512 = 3
+};
+
+/** Set of scanning kernels for one instruction set level. */
+struct scan_kernels
+{
+    const char* (*find_char)(const char* p, const char* end, char c);
+    const char* (*find_ws)(const char* p, const char* end);
+    const char* (*find_not_ws)(const char* p, const char* end);
+    const char* (*find_set)(const char* p, const char* end, const char_set& set);
+    const char* (*find_not_set)(const char* p, const char* end, const char_set& set);
+    const char* (*rfind_not_set)(const char* p, const char* end, const char_set& set);
+    unsigned long long (*csv_block)(const char* p, char sep, unsigned long long& quoted);
+    void (*map_case)(const char* p, const char* end, char* out, char first);
+    void (*translate)(const char* p, const char* end, char* out, const byte_map& map);
+    size_t (*mismatch_icase)(const char* a, const char* b, size_t n);
+    const char* (*find_non_ascii)(const char* p, const char* end);
+    const char* (*find_pair_icase)(const char* p, const char* end, char first, char last, size_t offset);
+    const char* (*find_pair)(const char* p, const char* end, char first, char last, size_t offset);
+};
+
+/** Detect the highest instruction set level supported by the running CPU. */
+static inline scan_isa scan_detect_isa()
+{
+#if STX_STRING_X86_SIMD
+    __builtin_cpu_init();
+#if STX_STRING_X86_AVX512
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("pclmul"))
+        return scan_isa_avx512;
+#endif
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul"))
+        return scan_isa_avx2;
+    if (__builtin_cpu_supports("sse2")) return scan_isa_sse2;
+#endif
+    return scan_isa_scalar;
 }
 
 /**
- * Join a sequence of strings by some glue string between each pair from the
- * sequence. The sequence in given as a range between two iterators.
- *
- * @param glue  string to glue
- * @param first the beginning iterator of the range to join
- * @param last  the ending iterator of the range to join
- * @return      string constructed from the range with the glue between two strings.
+ * Return the set of scanning kernels for the given instruction set level, or
+ * for the next lower level compiled in. The caller must make sure the CPU
+ * supports the level. Character set lookups require vpshufb, hence they use
+ * the scalar kernel on the SSE2 level. The AVX2 and AVX-512 levels also
+ * require PCLMULQDQ for the CSV quote masks, which all such CPUs implement.
+ * Byte translation also requires vpshufb and hence starts at the AVX2
+ * level.
  */
-template <typename input_iterator>
-static inline std::string join(const std::string& glue, input_iterator first, input_iterator last)
+static inline scan_kernels scan_get_kernels(scan_isa isa)
 {
-    std::string out;
-    if (first == last) return out;
+    scan_kernels k;
+    k.find_char = scan_char_scalar;
+    k.find_ws = scan_ws_scalar;
+    k.find_not_ws = scan_not_ws_scalar;
+    k.find_set = scan_set_scalar;
+    k.find_not_set = scan_not_set_scalar;
+    k.rfind_not_set = scan_not_set_reverse_scalar;
+    k.csv_block = scan_csv_block_scalar;
+    k.map_case = scan_map_case_scalar;
+    k.translate = scan_translate_scalar;
+    k.mismatch_icase = scan_mismatch_icase_scalar;
+    k.find_non_ascii = scan_non_ascii_scalar;
+    k.find_pair_icase = scan_pair_icase_scalar;
+    k.find_pair = scan_pair_scalar;
+#if STX_STRING_X86_SIMD
+    if (isa >= scan_isa_sse2) {
+        k.find_char = scan_char_sse2;
+        k.find_ws = scan_ws_sse2;
+        k.find_not_ws = scan_not_ws_sse2;
+        k.csv_block = scan_csv_block_sse2;
+        k.map_case = scan_map_case_sse2;
+        k.mismatch_icase = scan_mismatch_icase_sse2;
+        k.find_non_ascii = scan_non_ascii_sse2;
+        k.find_pair_icase = scan_pair_icase_sse2;
+        k.find_pair = scan_pair_sse2;
+    }
+    if (isa >= scan_isa_avx2) {
+        k.find_char = scan_char_avx2;
+        k.find_ws = scan_ws_avx2;
+        k.find_not_ws = scan_not_ws_avx2;
+        k.find_set = scan_set_avx2;
+        k.find_not_set = scan_not_set_avx2;
+        k.rfind_not_set = scan_not_set_reverse_avx2;
+        k.csv_block = scan_csv_block_avx2;
+        k.map_case = scan_map_case_avx2;
+        k.translate = scan_translate_avx2;
+        k.mismatch_icase = scan_mismatch_icase_avx2;
+        k.find_non_ascii = scan_non_ascii_avx2;
+        k.find_pair_icase = scan_pair_icase_avx2;
+        k.find_pair = scan_pair_avx2;
+    }
+#if STX_STRING_X86_AVX512
+    if (isa >= scan_isa_avx512) {
+        k.find_char = scan_char_avx512;
+        k.find_ws = scan_ws_avx512;
+        k.find_not_ws = scan_not_ws_avx512;
+        k.find_set = scan_set_avx512;
+        k.find_not_set = scan_not_set_avx512;
+        k.rfind_not_set = scan_not_set_reverse_avx512;
+        k.csv_block = scan_csv_block_avx512;
+        k.map_case = scan_map_case_avx512;
+        k.mismatch_icase = scan_mismatch_icase_avx512;
+        k.find_non_ascii = scan_non_ascii_avx512;
+        k.find_pair_icase = scan_pair_icase_avx512;
+        k.find_pair = scan_pair_avx512;
+    }
+#endif
+#else
+    (void)isa;
+#endif
+    return k;
+}
 
-    out.append(*first);
-    ++first;
+/** Return the best scanning kernels for the running CPU, detected once. */
+static inline const scan_kernels& scan_dispatch()
+{
+    static const scan_kernels kernels = scan_get_kernels(scan_detect_isa());
+    return kernels;
+}
 
-    while( first != last )
-    {
-        out.append(glue);
-        out.append(*first);
-        ++first;
-    }
+/*
+ * Ranges shorter than this are scanned by the inlined scalar loops, since
+ * they would be processed by the scalar tail of the kernels anyway.
+ */
+static const std::ptrdiff_t scan_simd_threshold = 16;
 
-    return out;
+// *** Scanning Functions ***
+
+/**
+ * Find the first occurrence of character c in [begin,end). Returns end if it
+ * is not found.
+ */
+static inline const char* find_char(const char* begin, const char* end, char c)
+{
+    if (end - begin < scan_simd_threshold)
+        return scan_char_scalar(begin, end, c);
+    return scan_dispatch().find_char(begin, end, c);
 }
 
 /**
- * Join a vector of strings by some glue string between each pair from the
- * sequence.
- *
- * @param glue  string to glue
- * @param parts the vector of strings to join
- * @return      string constructed from the vector with the glue between two strings.
+ * Find the first whitespace (as in split_ws()) in [begin,end). Returns end if
+ * none is found.
  */
-static inline std::string join(const std::string& glue, const std::vector<std::string>& parts)
+static inline const char* find_split_ws(const char* begin, const char* end)
 {
-    return join(glue, parts.begin(), parts.end());
+    if (end - begin < scan_simd_threshold)
+        return scan_ws_scalar(begin, end);
+    return scan_dispatch().find_ws(begin, end);
 }
 
-// ***                         ***
-// *** Random String Functions ***
-// ***                         ***
+/**
+ * Find the first non-whitespace (as in split_ws()) in [begin,end). Returns end
+ * if the range contains only whitespace.
+ */
+static inline const char* find_not_split_ws(const char* begin, const char* end)
+{
+    if (end - begin < scan_simd_threshold)
+        return scan_not_ws_scalar(begin, end);
+    return scan_dispatch().find_not_ws(begin, end);
+}
 
 /**
- * Generate a random binary string of given length. Any byte from 0-256 is
- * equally probable. Uses the pseudo-random number generator from stdlib; take
- * care to seed it using srand() before calling this function.
- *
- * @param size  length of result
- * @return      random binary string of given length
+ * Find the first character in [begin,end) which is contained in the set.
+ * Returns end if none is found.
  */
-static inline std::string random_binary(std::string::size_type size)
+static inline const char* find_any(const char* begin, const char* end, const char_set& set)
 {
-    std::string out;
-    out.resize(size);
+    if (end - begin < scan_simd_threshold)
+        return scan_set_scalar(begin, end, set);
+    return scan_dispatch().find_set(begin, end, set);
+}
 
-    for (size_t i = 0; i < size; ++i)
-        out[i] = static_cast<unsigned char>(rand() % 256);
+/**
+ * Find the first character in [begin,end) which is not contained in the set.
+ * Returns end if the range contains only characters from the set.
+ */
+static inline const char* find_not_any(const char* begin, const char* end, const char_set& set)
+{
+    if (end - begin < scan_simd_threshold)
+        return scan_not_set_scalar(begin, end, set);
+    return scan_dispatch().find_not_set(begin, end, set);
+}
 
-    return out;
+/**
+ * Find the last character in [begin,end) which is not contained in the set
+ * and return a pointer beyond it. Returns begin if the range contains only
+ * characters from the set.
+ */
+static inline const char* rfind_not_any(const char* begin, const char* end, const char_set& set)
+{
+    if (end - begin < scan_simd_threshold)
+        return scan_not_set_reverse_scalar(begin, end, set);
+    return scan_dispatch().rfind_not_set(begin, end, set);
 }
 
 /**
- * Generate a random string of given length. The set of available
- * bytes/characters is given as the second argument. Each byte is equally
- * probable. Uses the pseudo-random number generator from stdlib; take care to
- * seed it using srand() before calling this function.
- *
- * @param size  length of result
- * @param cset  character set to choose from
- * @return      random string of given length
+ * Find the first of n bytes at a and b which differ case-insensitively,
+ * folding only the ASCII letters. Returns its index, or n if the ranges are
+ * equal.
  */
-static inline std::string random(std::string::size_type size, const std::string& cset)
+static inline size_t mismatch_icase(const char* a, const char* b, size_t n)
 {
-    std::string out;
-    out.resize(size);
+    if (n < static_cast<size_t>(scan_simd_threshold))
+        return scan_mismatch_icase_scalar(a, b, n);
+    return scan_dispatch().mismatch_icase(a, b, n);
+}
 
-    for (size_t i = 0; i < size; ++i)
-        out[i] = cset[ rand() % cset.size() ];
+/**
+ * Compare n bytes at a and b case-insensitively, folding only the ASCII
+ * letters, like memcmp(). Returns the difference of the first mismatching
+ * lowercased bytes as unsigned char, hence negative if a is less than b, or
+ * zero if the ranges are equal.
+ */
+static inline int memcmp_icase(const char* a, const char* b, size_t n)
+{
+    size_t i = mismatch_icase(a, b, n);
+    if (i == n) return 0;
 
-    return out;
+    return static_cast<int>(static_cast<unsigned char>(scan_fold_ascii(a[i]))) -
+        static_cast<int>(static_cast<unsigned char>(scan_fold_ascii(b[i])));
 }
 
 /**
- * Generate a random string of given length. Any letter A-Z and a-z is equally
- * probable to occur. Uses the pseudo-random number generator from stdlib; take
- * care to seed it using srand() before calling this function.
- *
- * @param size  length of result
- * @return      random string of given length
+ * Find the first byte >= 0x80 in [begin,end), i.e. the first non-ASCII
+ * character of UTF-8 text. Returns end if the range is pure ASCII.
  */
-static inline std::string random_alpha(std::string::size_type size)
+static inline const char* find_non_ascii(const char* begin, const char* end)
 {
-    static const std::string letters =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    if (end - begin < scan_simd_threshold)
+        return scan_non_ascii_scalar(begin, end);
+    return scan_dispatch().find_non_ascii(begin, end);
+}
 
-    return random(size, letters);
+/**
+ * Find the first position q in [begin,end) at which q[0] and q[offset] match
+ * first and last case-insensitively, folding only the ASCII letters. first
+ * and last must be lowercase, and the bytes up to end - 1 + offset must be
+ * readable. Returns end if none is found.
+ */
+static inline const char* find_pair_icase(const char* begin, const char* end, char first, char last, size_t offset)
+{
+    if (end - begin < scan_simd_threshold)
+        return scan_pair_icase_scalar(begin, end, first, last, offset);
+    return scan_dispatch().find_pair_icase(begin, end, first, last, offset);
 }
 
 /**
- * Generate a random string of given length. Any letter A-Z and a-z or digit
- * 0-9 is equally probable to occur. Uses the pseudo-random number generator
- * from stdlib; take care to seed it using srand() before calling this
- * function.
- *
- * @param size  length of result
- * @return      random string of given length
+ * Find the first position q in [begin,end) at which q[0] and q[offset] equal
+ * first and last. The bytes up to end - 1 + offset must be readable. Returns
+ * end if none is found.
  */
-static inline std::string random_alphanumeric(std::string::size_type size)
+static inline const char* find_pair(const char* begin, const char* end, char first, char last, size_t offset)
 {
-    static const std::string letters =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    if (end - begin < scan_simd_threshold)
+        return scan_pair_scalar(begin, end, first, last, offset);
+    return scan_dispatch().find_pair(begin, end, first, last, offset);
+}
 
-    return random(size, letters);
+// *** Byte Translation Functions ***
+
+/**
+ * Convert the ASCII letters in [begin,end) to uppercase and write the result
+ * to out, which may be equal to begin. Other bytes are copied unchanged.
+ */
+static inline void toupper_ascii(const char* begin, const char* end, char* out)
+{
+    if (end - begin < scan_simd_threshold)
+        scan_map_case_scalar(begin, end, out, 'a');
+    else
+        scan_dispatch().map_case(begin, end, out, 'a');
+}
+
+/**
+ * Convert the ASCII letters in [begin,end) to lowercase and write the result
+ * to out, which may be equal to begin. Other bytes are copied unchanged.
+ */
+static inline void tolower_ascii(const char* begin, const char* end, char* out)
+{
+    if (end - begin < scan_simd_threshold)
+        scan_map_case_scalar(begin, end, out, 'A');
+    else
+        scan_dispatch().map_case(begin, end, out, 'A');
+}
+
+/**
+ * Translate the bytes in [begin,end) using the map and write the result to
+ * out, which may be equal to begin.
+ */
+static inline void translate(const char* begin, const char* end, char* out, const byte_map& map)
+{
+    if (end - begin < scan_simd_threshold)
+        scan_translate_scalar(begin, end, out, map);
+    else
+        scan_dispatch().translate(begin, end, out, map);
 }
 
 // ***                           ***
-// *** Hexadecimal Dump and Load ***
+// *** Whitespace Trim Functions ***
 // ***                           ***
 
+// *** Zero-Copy Trim Functions ***
+
 /**
- * Dump a (binary) string as a sequence of hexadecimal pairs.
+ * Trims the given string on the left and right. Removes all characters in the
+ * given drop set, which defaults to " ". Returns a reference to the remaining
+ * characters, the referenced string must outlive it.
  *
- * @param str   string to output in hex
- * @return      string of hexadecimal pairs
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the trimmed part of str
  */
-static inline std::string hexdump(const std::string& str)
+static inline string_ref trim_view(const string_ref& str, const char_set& drop = " ")
 {
-    std::string out;
-    out.resize( str.size() * 2 );
-
-    static const char xdigits[16] = {
-        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-    };
-
-    std::string::iterator oi = out.begin();
-    for (std::string::const_iterator si = str.begin();
-         si != str.end(); ++si)
-    {
-        *oi++ = xdigits[ (*si & 0xF0) >> 4 ];
-        *oi++ = xdigits[ (*si & 0x0F) ];
-    }
+    const char* last = rfind_not_any(str.begin(), str.end(), drop);
+    return string_ref(find_not_any(str.begin(), last, drop), last);
+}
 
-    return out;
+/**
+ * Trims the given string only on the left. Removes all characters in the given
+ * drop set, which defaults to " ". Returns a reference to the remaining
+ * characters, the referenced string must outlive it.
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the trimmed part of str
+ */
+static inline string_ref trim_left_view(const string_ref& str, const char_set& drop = " ")
+{
+    return string_ref(find_not_any(str.begin(), str.end(), drop), str.end());
 }
 
 /**
- * Dump a (binary) memory buffer as a sequence of hexadecimal pairs.
+ * Trims the given string only on the right. Removes all characters in the
+ * given drop set, which defaults to " ". Returns a reference to the remaining
+ * characters, the referenced string must outlive it.
  *
- * @param data  pointer to input
- * @param len   length of input
- * @return      string of hexadecimal pairs
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the trimmed part of str
  */
-static inline std::string hexdump(const void* data, size_t len)
+static inline string_ref trim_right_view(const string_ref& str, const char_set& drop = " ")
 {
-    return hexdump(std::string(static_cast<const char*>(data),len));
+    return string_ref(str.begin(), rfind_not_any(str.begin(), str.end(), drop));
 }
 
+// *** Copying Trim Functions ***
+
 /**
- * Read a string as a sequence of hexadecimal pairs. Converts each pair of
- * hexadecimal digits into a byte of the output string. Throws
- * std::runtime_error() if an unknown letter is encountered.
+ * Trims the given string on the left and right. Removes all characters in the
+ * given drop set, which defaults to " ". Returns a copy of the string.
  *
- * @param str   string to parse as hex digits
- * @return      string of read bytes
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      new trimmed string
  */
-static inline std::string parse_hexdump(const std::string& str)
+static inline std::string trim(const std::string& str, const char_set& drop = " ")
 {
-    std::string out;
-    int n = 0;
-    unsigned char c = 0;
+    return trim_view(str, drop).str();
+}
 
-    for (std::string::const_iterator si = str.begin();
-         si != str.end(); ++si)
-    {
-        switch(*si)
+/**
+ * Trims the given string only on the left. Removes all characters in the given
+ * drop set, which defaults to " ". Returns a copy of the string.
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      new trimmed string
+ */
+static inline std::string trim_left(const std::string& str, const char_set& drop = " ")
+{
+    return trim_left_view(str, drop).str();
+}
+
+/**
+ * Trims the given string only on the right. Removes all characters in the
+ * given drop set, which defaults to " ". Returns a copy of the string.
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      new trimmed string
+ */
+static inline std::string trim_right(const std::string& str, const char_set& drop = " ")
+{
+    return trim_right_view(str, drop).str();
+}
+
+// *** In-Place Trim Functions ***
+
+/**
+ * Replace the contents of str with the given part of itself, moving the
+ * characters at most once.
+ */
+static inline std::string& trim_assign_inplace(std::string& str, const string_ref& part)
+{
+    std::string::size_type first = static_cast<std::string::size_type>(part.data() - str.data());
+    if (first != 0)
+        std::copy(part.begin(), part.end(), str.begin());
+    str.resize(part.size());
+    return str;
+}
+
+/**
+ * Trims the given string in-place on the left and right. Removes all
+ * characters in the given drop set, which defaults to " ".
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the modified string
+ */
+static inline std::string& trim_inplace(std::string& str, const char_set& drop = " ")
+{
+    return trim_assign_inplace(str, trim_view(str, drop));
+}
+
+/**
+ * Trims the given string in-place only on the left. Removes all characters in
+ * the given drop set, which defaults to " ".
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the modified string
+ */
+static inline std::string& trim_left_inplace(std::string& str, const char_set& drop = " ")
+{
+    return trim_assign_inplace(str, trim_left_view(str, drop));
+}
+
+/**
+ * Trims the given string in-place only on the right. Removes all characters in
+ * the given drop set, which defaults to " ".
+ *
+ * @param str   string to process
+ * @param drop  remove these characters
+ * @return      reference to the modified string
+ */
+static inline std::string& trim_right_inplace(std::string& str, const char_set& drop = " ")
+{
+    str.resize(static_cast<std::string::size_type>(
+                   rfind_not_any(str.data(), str.data() + str.size(), drop) - str.data()));
+    return str;
+}
+
+// ***                                 ***
+// ***  Upper and Lower Case Functions ***
+// ***                                 ***
+
+/** toupper() functional for std::transform with correct signature. */
+static inline char char_toupper_functional(char c)
+{
+    return static_cast<char>(std::toupper(c));
+}
+
+/** tolower() functional for std::transform with correct signature. */
+static inline char char_tolower_functional(char c)
+{
+    return static_cast<char>(std::tolower(c));
+}
+
+/**
+ * Returns a copy of the given string converted to uppercase. Only the ASCII
+ * letters are converted, independent of the locale.
+ *
+ * @param str   string to process
+ * @return      new string uppercased
+ */
+static inline std::string toupper(const std::string& str)
+{
+    std::string strcopy(str.size(), 0);
+    if (!str.empty())
+        toupper_ascii(str.data(), str.data() + str.size(), &strcopy[0]);
+    return strcopy;
+}
+
+/**
+ * Returns a copy of the given string converted to lowercase. Only the ASCII
+ * letters are converted, independent of the locale.
+ *
+ * @param str   string to process
+ * @return      new string lowercased
+ */
+static inline std::string tolower(const std::string& str)
+{
+    std::string strcopy(str.size(), 0);
+    if (!str.empty())
+        tolower_ascii(str.data(), str.data() + str.size(), &strcopy[0]);
+    return strcopy;
+}
+
+/**
+ * Transforms the given string to uppercase and returns a reference to it. Only
+ * the ASCII letters are converted, independent of the locale.
+ *
+ * @param str   string to process
+ * @return      reference to the modified string
+ */
+static inline std::string& toupper_inplace(std::string& str)
+{
+    if (!str.empty())
+        toupper_ascii(str.data(), str.data() + str.size(), &str[0]);
+    return str;
+}
+
+/**
+ * Transforms the given string to lowercase and returns a reference to it. Only
+ * the ASCII letters are converted, independent of the locale.
+ *
+ * @param str   string to process
+ * @return      reference to the modified string
+ */
+static inline std::string& tolower_inplace(std::string& str)
+{
+    if (!str.empty())
+        tolower_ascii(str.data(), str.data() + str.size(), &str[0]);
+    return str;
+}
+
+/**
+ * Returns a copy of the given string with each byte replaced as given by the
+ * byte map, like the tr utility.
+ *
+ * @param str   string to process
+ * @param map   byte translation table
+ * @return      new string translated
+ */
+static inline std::string translate(const std::string& str, const byte_map& map)
+{
+    std::string strcopy(str.size(), 0);
+    if (!str.empty())
+        translate(str.data(), str.data() + str.size(), &strcopy[0], map);
+    return strcopy;
+}
+
+/**
+ * Replaces each byte of the given string as given by the byte map, like the tr
+ * utility, and returns a reference to it.
+ *
+ * @param str   string to process
+ * @param map   byte translation table
+ * @return      reference to the modified string
+ */
+static inline std::string& translate_inplace(std::string& str, const byte_map& map)
+{
+    if (!str.empty())
+        translate(str.data(), str.data() + str.size(), &str[0], map);
+    return str;
+}
+
+// ***                              ***
+// *** Case-insensitive Comparision ***
+// ***                              ***
+
+/**
+ * Binary class functional which compares two characters
+ * case-insensitively. Returns true if they are equal.
+ */
+struct char_icase_equal : public std::binary_function<char, char, bool>
+{
+    bool operator() (const char& c1, const char& c2) const
+    { return std::tolower(c1) == std::tolower(c2); }
+};
+
+/**
+ * Binary class functional which compares two characters
+ * case-insensitively. Returns true if the first is less than the second.
+ */
+struct char_icase_less : public std::binary_function<char, char, bool>
+{
+    bool operator() (const char& c1, const char& c2) const
+    { return std::tolower(c1) < std::tolower(c2); }
+};
+
+/**
+ * Compare two strings case-insensitively. Return true if they are equal.
+ */
+static inline bool equal_icase(const std::string& a, const std::string& b)
+{
+    if (a.size() != b.size()) return false;
+
+    return memcmp_icase(a.data(), b.data(), a.size()) == 0;
+}
+
+/**
+ * Compare two string case-insensitively. Return true if this one is less than
+ * the other.
+ */
+static inline bool less_icase(const std::string& a, const std::string& b)
+{
+    int r = memcmp_icase(a.data(), b.data(), std::min(a.size(), b.size()));
+    if (r != 0) return (r < 0);
+
+    return (a.size() < b.size());
+}
+
+/**
+ * Compare two string case-insensitively. Returns 0 if they are equal, -1 if a
+ * is lexicographical before b, +1 if a is after b.
+ */
+static inline int compare_icase(const std::string& a, const std::string& b)
+{
+    int r = memcmp_icase(a.data(), b.data(), std::min(a.size(), b.size()));
+    if (r != 0) return (r < 0) ? -1 : +1;
+
+    if (a.size() < b.size()) return +1;
+    else if (a.size() > b.size()) return -1;
+    else return 0;
+}
+
+/**
+ * Case-sensitive less order relation functional class for std::map.
+ */
+struct order_less
+{
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return (a < b);
+    }
+};
+
+/**
+ * Case-insensitive less order relation functional class for std::map. Uses the
+ * SIMD case-folding compare kernels via less_icase().
+ */
+struct order_less_icase
+{
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return less_icase(a, b);
+    }
+};
+
+/**
+ * Descending case-sensitive less order relation functional class for
+ * std::map.
+ */
+struct order_less_desc
+{
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return !(a < b);
+    }
+};
+
+/**
+ * Descending case-insensitive less order relation functional class for
+ * std::map.
+ */
+struct order_less_icase_desc
+{
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return !less_icase(a, b);
+    }
+};
+
+/**
+ * Hash a byte range case-insensitively, consistent with equal_icase(): ASCII
+ * letters are folded to lowercase inside the hash loop, eight bytes at a time
+ * using SWAR arithmetic, without building a lowered copy.
+ *
+ * @param data  start of the byte range
+ * @param size  length of the byte range
+ * @return      64-bit hash value
+ */
+static inline unsigned long long hash_icase(const char* data, size_t size)
+{
+    const unsigned long long ones = 0x0101010101010101ull;
+    const unsigned long long mul = 0x9E3779B97F4A7C15ull;
+
+    unsigned long long h = size * mul;
+
+    while (size != 0)
+    {
+        unsigned long long w = 0;
+        size_t n = (size < 8) ? size : 8;
+        memcpy(&w, data, n);
+
+        // set 0x20 in each byte 'A'-'Z': the high bit of a byte in the sums
+        // is set if its low seven bits are >= 'A' or > 'Z', respectively
+        unsigned long long low7 = w & (0x7F * ones);
+        unsigned long long ge_a = low7 + (0x80 - 'A') * ones;
+        unsigned long long gt_z = low7 + (0x7F - 'Z') * ones;
+        unsigned long long upper = (ge_a ^ gt_z) & ~w & (0x80 * ones);
+        w |= upper >> 2;
+
+        h = (((h << 5) | (h >> 59)) ^ w) * mul;
+        data += n, size -= n;
+    }
+
+    // final avalanche
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Case-insensitive hash functional class for std::unordered_map and others,
+ * matching equal_icase() and icase_equal. It is transparent: std::string,
+ * string_ref and const char* keys hash alike, without building a
+ * std::string.
+ */
+struct icase_hash
+{
+    typedef void is_transparent;
+
+    inline size_t operator()(const string_ref& str) const {
+        return static_cast<size_t>(hash_icase(str.data(), str.size()));
+    }
+};
+
+/**
+ * Case-insensitive equality functional class for std::unordered_map and
+ * others, matching equal_icase() and icase_hash. It is transparent and
+ * compares std::string, string_ref and const char* keys.
+ */
+struct icase_equal
+{
+    typedef void is_transparent;
+
+    inline bool operator()(const string_ref& a, const string_ref& b) const {
+        return a.size() == b.size() &&
+            memcmp_icase(a.data(), b.data(), a.size()) == 0;
+    }
+};
+
+// ***                              ***
+// *** Case-insensitive String Type ***
+// ***                              ***
+
+/** Return the ASCII lowercase of c, a constant expression in C++11. */
+static inline STX_STRING_CONSTEXPR char ascii_tolower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+/** Return the ASCII uppercase of c, a constant expression in C++11. */
+static inline STX_STRING_CONSTEXPR char ascii_toupper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : c;
+}
+
+#define STX_STRING_CASE_ROW(F, r)                                       \
+    F(r + 0), F(r + 1), F(r + 2), F(r + 3), F(r + 4), F(r + 5),         \
+    F(r + 6), F(r + 7), F(r + 8), F(r + 9), F(r + 10), F(r + 11),       \
+    F(r + 12), F(r + 13), F(r + 14), F(r + 15)
+
+#define STX_STRING_CASE_TABLE(F)                                        \
+    {                                                                   \
+        STX_STRING_CASE_ROW(F, 0), STX_STRING_CASE_ROW(F, 16),          \
+        STX_STRING_CASE_ROW(F, 32), STX_STRING_CASE_ROW(F, 48),         \
+        STX_STRING_CASE_ROW(F, 64), STX_STRING_CASE_ROW(F, 80),         \
+        STX_STRING_CASE_ROW(F, 96), STX_STRING_CASE_ROW(F, 112),        \
+        STX_STRING_CASE_ROW(F, 128), STX_STRING_CASE_ROW(F, 144),       \
+        STX_STRING_CASE_ROW(F, 160), STX_STRING_CASE_ROW(F, 176),       \
+        STX_STRING_CASE_ROW(F, 192), STX_STRING_CASE_ROW(F, 208),       \
+        STX_STRING_CASE_ROW(F, 224), STX_STRING_CASE_ROW(F, 240)        \
+    }
+
+#define STX_STRING_CASE_LOWER(c) \
+    static_cast<unsigned char>(((c) >= 'A' && (c) <= 'Z') ? (c) + 32 : (c))
+
+#define STX_STRING_CASE_UPPER(c) \
+    static_cast<unsigned char>(((c) >= 'a' && (c) <= 'z') ? (c) - 32 : (c))
+
+/**
+ * ASCII case mapping tables indexed by unsigned char, which are constant
+ * expressions in C++11. The template parameter only allows defining the
+ * tables in the header.
+ */
+template <typename Dummy = void>
+struct ascii_case_tables
+{
+#if __cplusplus >= 201103L
+    //! lowercase of each byte
+    static constexpr unsigned char lower[256] = STX_STRING_CASE_TABLE(STX_STRING_CASE_LOWER);
+
+    //! uppercase of each byte
+    static constexpr unsigned char upper[256] = STX_STRING_CASE_TABLE(STX_STRING_CASE_UPPER);
+#else
+    //! lowercase of each byte
+    static const unsigned char lower[256];
+
+    //! uppercase of each byte
+    static const unsigned char upper[256];
+#endif
+};
+
+#if __cplusplus >= 201103L
+template <typename Dummy>
+constexpr unsigned char ascii_case_tables<Dummy>::lower[256];
+
+template <typename Dummy>
+constexpr unsigned char ascii_case_tables<Dummy>::upper[256];
+#else
+template <typename Dummy>
+const unsigned char ascii_case_tables<Dummy>::lower[256] =
+    STX_STRING_CASE_TABLE(STX_STRING_CASE_LOWER);
+
+template <typename Dummy>
+const unsigned char ascii_case_tables<Dummy>::upper[256] =
+    STX_STRING_CASE_TABLE(STX_STRING_CASE_UPPER);
+#endif
+
+#undef STX_STRING_CASE_ROW
+#undef STX_STRING_CASE_TABLE
+#undef STX_STRING_CASE_LOWER
+#undef STX_STRING_CASE_UPPER
+
+/**
+ * Character traits which compare characters case-insensitively like
+ * char_icase_equal, but folding only the ASCII letters as equal_icase()
+ * does. compare() uses the SIMD folding kernels and find() the scanning
+ * kernels.
+ */
+struct icase_char_traits : public std::char_traits<char>
+{
+    //! compare two characters case-insensitively for equality
+    static bool eq(char a, char b)
+    {
+        return ascii_case_tables<>::lower[static_cast<unsigned char>(a)] ==
+               ascii_case_tables<>::lower[static_cast<unsigned char>(b)];
+    }
+
+    //! compare two characters case-insensitively for order
+    static bool lt(char a, char b)
+    {
+        return ascii_case_tables<>::lower[static_cast<unsigned char>(a)] <
+               ascii_case_tables<>::lower[static_cast<unsigned char>(b)];
+    }
+
+    //! compare n characters case-insensitively
+    static int compare(const char* a, const char* b, size_t n)
+    {
+        return memcmp_icase(a, b, n);
+    }
+
+    //! find the first of n characters equal to c case-insensitively
+    static const char* find(const char* p, size_t n, const char& c)
+    {
+        const char* end = p + n;
+        char lc = ascii_tolower(c), uc = ascii_toupper(c);
+
+        const char* it = find_char(p, end, lc);
+        // search for the other case only up to the first hit
+        if (lc != uc) it = find_char(p, it, uc);
+
+        return (it == end) ? NULL : it;
+    }
+};
+
+/**
+ * String type which compares and searches case-insensitively, hence operator
+ * ==, find() and std::map can be used directly on keys.
+ */
+typedef std::basic_string<char, icase_char_traits> icase_string;
+
+/**
+ * Compare an icase_string with a string of other traits case-insensitively,
+ * ordering like icase_char_traits::compare().
+ */
+static inline int icase_string_compare(const string_ref& a, const string_ref& b)
+{
+    int r = memcmp_icase(a.data(), b.data(), std::min(a.size(), b.size()));
+    if (r != 0) return r;
+    return (a.size() < b.size()) ? -1 : (a.size() > b.size()) ? 1 : 0;
+}
+
+/*
+ * Comparisons of icase_string with std::string and string_ref in both
+ * operand orders. Without them, the other operand converts both to
+ * string_ref, which compares case-sensitively. The icase_string operand is
+ * deduced, hence C strings do not convert to it.
+ */
+#define STX_STRING_ICASE_OPERATOR(OP)                                         \
+    template <typename Alloc>                                                 \
+    static inline bool operator OP (                                          \
+        const std::basic_string<char, icase_char_traits, Alloc>& a,           \
+        const string_ref& b)                                                  \
+    { return icase_string_compare(a, b) OP 0; }                               \
+    template <typename Alloc>                                                 \
+    static inline bool operator OP (                                          \
+        const string_ref& a,                                                  \
+        const std::basic_string<char, icase_char_traits, Alloc>& b)           \
+    { return icase_string_compare(a, b) OP 0; }
+
+STX_STRING_ICASE_OPERATOR(==)
+STX_STRING_ICASE_OPERATOR(!=)
+STX_STRING_ICASE_OPERATOR(<)
+STX_STRING_ICASE_OPERATOR(>)
+STX_STRING_ICASE_OPERATOR(<=)
+STX_STRING_ICASE_OPERATOR(>=)
+
+#undef STX_STRING_ICASE_OPERATOR
+
+/**
+ * Compare a string case-insensitively with a string literal. The length of
+ * the literal is known at compile time, hence short comparisons are unrolled
+ * by the compiler. Only pass string literals, not partially filled character
+ * arrays.
+ *
+ * @param str           string to compare
+ * @param literal       string literal to compare with
+ * @return              true if the strings are equal case-insensitively
+ */
+template <size_t N>
+static inline bool equal_icase_literal(const string_ref& str, const char (&literal)[N])
+{
+    if (str.size() != N - 1) return false;
+    if (N - 1 < static_cast<size_t>(scan_simd_threshold))
+        return scan_mismatch_icase_scalar(str.data(), literal, N - 1) == N - 1;
+    return memcmp_icase(str.data(), literal, N - 1) == 0;
+}
+
+// ***                    ***
+// *** UTF-8 Case Folding ***
+// ***                    ***
+
+/**
+ * Range of the case folding table: the code points first, first + stride, ...
+ * up to last fold to the code point plus delta.
+ */
+struct utf8_fold_range
+{
+    unsigned int first, last;
+    int delta;
+    unsigned int stride;
+};
+
+/**
+ * Unicode simple case folding (CaseFolding.txt status C and S) of all
+ * non-ASCII code points, generated from Unicode 14.0 and compressed into
+ * ranges of stride 1, or stride 2 for alternating upper and lowercase pairs.
+ * The template parameter only allows defining the table in the header.
+ */
+template <typename Dummy = void>
+struct utf8_fold_tables
+{
+    //! number of ranges
+    static const size_t size = 201;
+
+    //! ranges sorted by first code point
+    static const utf8_fold_range ranges[201];
+};
+
+template <typename Dummy>
+const utf8_fold_range utf8_fold_tables<Dummy>::ranges[201] = {
+    { 0x00B5, 0x00B5, 775, 1 }, { 0x00C0, 0x00D6, 32, 1 },
+    { 0x00D8, 0x00DE, 32, 1 }, { 0x0100, 0x012E, 1, 2 },
+    { 0x0132, 0x0136, 1, 2 }, { 0x0139, 0x0147, 1, 2 },
+    { 0x014A, 0x0176, 1, 2 }, { 0x0178, 0x0178, -121, 1 },
+    { 0x0179, 0x017D, 1, 2 }, { 0x017F, 0x017F, -268, 1 },
+    { 0x0181, 0x0181, 210, 1 }, { 0x0182, 0x0184, 1, 2 },
+    { 0x0186, 0x0186, 206, 1 }, { 0x0187, 0x0187, 1, 1 },
+    { 0x0189, 0x018A, 205, 1 }, { 0x018B, 0x018B, 1, 1 },
+    { 0x018E, 0x018E, 79, 1 }, { 0x018F, 0x018F, 202, 1 },
+    { 0x0190, 0x0190, 203, 1 }, { 0x0191, 0x0191, 1, 1 },
+    { 0x0193, 0x0193, 205, 1 }, { 0x0194, 0x0194, 207, 1 },
+    { 0x0196, 0x0196, 211, 1 }, { 0x0197, 0x0197, 209, 1 },
+    { 0x0198, 0x0198, 1, 1 }, { 0x019C, 0x019C, 211, 1 },
+    { 0x019D, 0x019D, 213, 1 }, { 0x019F, 0x019F, 214, 1 },
+    { 0x01A0, 0x01A4, 1, 2 }, { 0x01A6, 0x01A6, 218, 1 },
+    { 0x01A7, 0x01A7, 1, 1 }, { 0x01A9, 0x01A9, 218, 1 },
+    { 0x01AC, 0x01AC, 1, 1 }, { 0x01AE, 0x01AE, 218, 1 },
+    { 0x01AF, 0x01AF, 1, 1 }, { 0x01B1, 0x01B2, 217, 1 },
+    { 0x01B3, 0x01B5, 1, 2 }, { 0x01B7, 0x01B7, 219, 1 },
+    { 0x01B8, 0x01B8, 1, 1 }, { 0x01BC, 0x01BC, 1, 1 },
+    { 0x01C4, 0x01C4, 2, 1 }, { 0x01C5, 0x01C5, 1, 1 },
+    { 0x01C7, 0x01C7, 2, 1 }, { 0x01C8, 0x01C8, 1, 1 },
+    { 0x01CA, 0x01CA, 2, 1 }, { 0x01CB, 0x01DB, 1, 2 },
+    { 0x01DE, 0x01EE, 1, 2 }, { 0x01F1, 0x01F1, 2, 1 },
+    { 0x01F2, 0x01F4, 1, 2 }, { 0x01F6, 0x01F6, -97, 1 },
+    { 0x01F7, 0x01F7, -56, 1 }, { 0x01F8, 0x021E, 1, 2 },
+    { 0x0220, 0x0220, -130, 1 }, { 0x0222, 0x0232, 1, 2 },
+    { 0x023A, 0x023A, 10795, 1 }, { 0x023B, 0x023B, 1, 1 },
+    { 0x023D, 0x023D, -163, 1 }, { 0x023E, 0x023E, 10792, 1 },
+    { 0x0241, 0x0241, 1, 1 }, { 0x0243, 0x0243, -195, 1 },
+    { 0x0244, 0x0244, 69, 1 }, { 0x0245, 0x0245, 71, 1 },
+    { 0x0246, 0x024E, 1, 2 }, { 0x0345, 0x0345, 116, 1 },
+    { 0x0370, 0x0372, 1, 2 }, { 0x0376, 0x0376, 1, 1 },
+    { 0x037F, 0x037F, 116, 1 }, { 0x0386, 0x0386, 38, 1 },
+    { 0x0388, 0x038A, 37, 1 }, { 0x038C, 0x038C, 64, 1 },
+    { 0x038E, 0x038F, 63, 1 }, { 0x0391, 0x03A1, 32, 1 },
+    { 0x03A3, 0x03AB, 32, 1 }, { 0x03C2, 0x03C2, 1, 1 },
+    { 0x03CF, 0x03CF, 8, 1 }, { 0x03D0, 0x03D0, -30, 1 },
+    { 0x03D1, 0x03D1, -25, 1 }, { 0x03D5, 0x03D5, -15, 1 },
+    { 0x03D6, 0x03D6, -22, 1 }, { 0x03D8, 0x03EE, 1, 2 },
+    { 0x03F0, 0x03F0, -54, 1 }, { 0x03F1, 0x03F1, -48, 1 },
+    { 0x03F4, 0x03F4, -60, 1 }, { 0x03F5, 0x03F5, -64, 1 },
+    { 0x03F7, 0x03F7, 1, 1 }, { 0x03F9, 0x03F9, -7, 1 },
+    { 0x03FA, 0x03FA, 1, 1 }, { 0x03FD, 0x03FF, -130, 1 },
+    { 0x0400, 0x040F, 80, 1 }, { 0x0410, 0x042F, 32, 1 },
+    { 0x0460, 0x0480, 1, 2 }, { 0x048A, 0x04BE, 1, 2 },
+    { 0x04C0, 0x04C0, 15, 1 }, { 0x04C1, 0x04CD, 1, 2 },
+    { 0x04D0, 0x052E, 1, 2 }, { 0x0531, 0x0556, 48, 1 },
+    { 0x10A0, 0x10C5, 7264, 1 }, { 0x10C7, 0x10C7, 7264, 1 },
+    { 0x10CD, 0x10CD, 7264, 1 }, { 0x13F8, 0x13FD, -8, 1 },
+    { 0x1C80, 0x1C80, -6222, 1 }, { 0x1C81, 0x1C81, -6221, 1 },
+    { 0x1C82, 0x1C82, -6212, 1 }, { 0x1C83, 0x1C84, -6210, 1 },
+    { 0x1C85, 0x1C85, -6211, 1 }, { 0x1C86, 0x1C86, -6204, 1 },
+    { 0x1C87, 0x1C87, -6180, 1 }, { 0x1C88, 0x1C88, 35267, 1 },
+    { 0x1C90, 0x1CBA, -3008, 1 }, { 0x1CBD, 0x1CBF, -3008, 1 },
+    { 0x1E00, 0x1E94, 1, 2 }, { 0x1E9B, 0x1E9B, -58, 1 },
+    { 0x1E9E, 0x1E9E, -7615, 1 }, { 0x1EA0, 0x1EFE, 1, 2 },
+    { 0x1F08, 0x1F0F, -8, 1 }, { 0x1F18, 0x1F1D, -8, 1 },
+    { 0x1F28, 0x1F2F, -8, 1 }, { 0x1F38, 0x1F3F, -8, 1 },
+    { 0x1F48, 0x1F4D, -8, 1 }, { 0x1F59, 0x1F5F, -8, 2 },
+    { 0x1F68, 0x1F6F, -8, 1 }, { 0x1F88, 0x1F8F, -8, 1 },
+    { 0x1F98, 0x1F9F, -8, 1 }, { 0x1FA8, 0x1FAF, -8, 1 },
+    { 0x1FB8, 0x1FB9, -8, 1 }, { 0x1FBA, 0x1FBB, -74, 1 },
+    { 0x1FBC, 0x1FBC, -9, 1 }, { 0x1FBE, 0x1FBE, -7173, 1 },
+    { 0x1FC8, 0x1FCB, -86, 1 }, { 0x1FCC, 0x1FCC, -9, 1 },
+    { 0x1FD8, 0x1FD9, -8, 1 }, { 0x1FDA, 0x1FDB, -100, 1 },
+    { 0x1FE8, 0x1FE9, -8, 1 }, { 0x1FEA, 0x1FEB, -112, 1 },
+    { 0x1FEC, 0x1FEC, -7, 1 }, { 0x1FF8, 0x1FF9, -128, 1 },
+    { 0x1FFA, 0x1FFB, -126, 1 }, { 0x1FFC, 0x1FFC, -9, 1 },
+    { 0x2126, 0x2126, -7517, 1 }, { 0x212A, 0x212A, -8383, 1 },
+    { 0x212B, 0x212B, -8262, 1 }, { 0x2132, 0x2132, 28, 1 },
+    { 0x2160, 0x216F, 16, 1 }, { 0x2183, 0x2183, 1, 1 },
+    { 0x24B6, 0x24CF, 26, 1 }, { 0x2C00, 0x2C2F, 48, 1 },
+    { 0x2C60, 0x2C60, 1, 1 }, { 0x2C62, 0x2C62, -10743, 1 },
+    { 0x2C63, 0x2C63, -3814, 1 }, { 0x2C64, 0x2C64, -10727, 1 },
+    { 0x2C67, 0x2C6B, 1, 2 }, { 0x2C6D, 0x2C6D, -10780, 1 },
+    { 0x2C6E, 0x2C6E, -10749, 1 }, { 0x2C6F, 0x2C6F, -10783, 1 },
+    { 0x2C70, 0x2C70, -10782, 1 }, { 0x2C72, 0x2C72, 1, 1 },
+    { 0x2C75, 0x2C75, 1, 1 }, { 0x2C7E, 0x2C7F, -10815, 1 },
+    { 0x2C80, 0x2CE2, 1, 2 }, { 0x2CEB, 0x2CED, 1, 2 },
+    { 0x2CF2, 0x2CF2, 1, 1 }, { 0xA640, 0xA66C, 1, 2 },
+    { 0xA680, 0xA69A, 1, 2 }, { 0xA722, 0xA72E, 1, 2 },
+    { 0xA732, 0xA76E, 1, 2 }, { 0xA779, 0xA77B, 1, 2 },
+    { 0xA77D, 0xA77D, -35332, 1 }, { 0xA77E, 0xA786, 1, 2 },
+    { 0xA78B, 0xA78B, 1, 1 }, { 0xA78D, 0xA78D, -42280, 1 },
+    { 0xA790, 0xA792, 1, 2 }, { 0xA796, 0xA7A8, 1, 2 },
+    { 0xA7AA, 0xA7AA, -42308, 1 }, { 0xA7AB, 0xA7AB, -42319, 1 },
+    { 0xA7AC, 0xA7AC, -42315, 1 }, { 0xA7AD, 0xA7AD, -42305, 1 },
+    { 0xA7AE, 0xA7AE, -42308, 1 }, { 0xA7B0, 0xA7B0, -42258, 1 },
+    { 0xA7B1, 0xA7B1, -42282, 1 }, { 0xA7B2, 0xA7B2, -42261, 1 },
+    { 0xA7B3, 0xA7B3, 928, 1 }, { 0xA7B4, 0xA7C2, 1, 2 },
+    { 0xA7C4, 0xA7C4, -48, 1 }, { 0xA7C5, 0xA7C5, -42307, 1 },
+    { 0xA7C6, 0xA7C6, -35384, 1 }, { 0xA7C7, 0xA7C9, 1, 2 },
+    { 0xA7D0, 0xA7D0, 1, 1 }, { 0xA7D6, 0xA7D8, 1, 2 },
+    { 0xA7F5, 0xA7F5, 1, 1 }, { 0xAB70, 0xABBF, -38864, 1 },
+    { 0xFF21, 0xFF3A, 32, 1 }, { 0x10400, 0x10427, 40, 1 },
+    { 0x104B0, 0x104D3, 40, 1 }, { 0x10570, 0x1057A, 39, 1 },
+    { 0x1057C, 0x1058A, 39, 1 }, { 0x1058C, 0x10592, 39, 1 },
+    { 0x10594, 0x10595, 39, 1 }, { 0x10C80, 0x10CB2, 64, 1 },
+    { 0x118A0, 0x118BF, 32, 1 }, { 0x16E40, 0x16E5F, 32, 1 },
+    { 0x1E900, 0x1E921, 34, 1 }
+};
+
+/**
+ * Return the simple case folding of the code point, which is mostly its
+ * lowercase. Invalid code points are returned unchanged.
+ */
+static inline unsigned int utf8_fold_codepoint(unsigned int cp)
+{
+    if (cp < 0x80)
+        return static_cast<unsigned char>(ascii_tolower(static_cast<char>(cp)));
+
+    // binary search for the last range with first <= cp
+    const utf8_fold_range* ranges = utf8_fold_tables<>::ranges;
+    size_t lo = 0, hi = utf8_fold_tables<>::size;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (ranges[mid].first <= cp) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return cp;
+
+    const utf8_fold_range& r = ranges[lo - 1];
+    if (cp > r.last || (cp - r.first) % r.stride != 0) return cp;
+    return static_cast<unsigned int>(static_cast<int>(cp) + r.delta);
+}
+
+/**
+ * Decode the UTF-8 sequence at p and advance p beyond it. An invalid,
+ * overlong or truncated sequence is decoded as its first byte only, which is
+ * returned as 0x110000 + byte, hence it differs from all code points and
+ * utf8_encode() restores the byte.
+ */
+static inline unsigned int utf8_decode(const char*& p, const char* end)
+{
+    unsigned int c = static_cast<unsigned char>(*p++);
+    if (c < 0x80) return c;
+
+    unsigned int n, cp, min;
+    if (c >= 0xC2 && c <= 0xDF) n = 1, cp = c & 0x1F, min = 0x80;
+    else if (c >= 0xE0 && c <= 0xEF) n = 2, cp = c & 0x0F, min = 0x800;
+    else if (c >= 0xF0 && c <= 0xF4) n = 3, cp = c & 0x07, min = 0x10000;
+    else return 0x110000 + c;
+
+    if (end - p < static_cast<std::ptrdiff_t>(n)) return 0x110000 + c;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        unsigned int t = static_cast<unsigned char>(p[i]);
+        if ((t & 0xC0) != 0x80) return 0x110000 + c;
+        cp = (cp << 6) | (t & 0x3F);
+    }
+
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        return 0x110000 + c;
+
+    p += n;
+    return cp;
+}
+
+/**
+ * Append the UTF-8 encoding of the code point to the string. Values 0x110000
+ * + byte from utf8_decode() are appended as the raw byte.
+ */
+static inline void utf8_encode(std::string& out, unsigned int cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x110000) {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(cp - 0x110000);
+    }
+}
+
+/**
+ * Returns a case folded copy of the UTF-8 string, in which all characters
+ * comparing equal case-insensitively are identical. Runs of ASCII characters
+ * are located and lowercased by the SIMD kernels; only the other characters
+ * are decoded and looked up in the folding table. Invalid UTF-8 bytes are
+ * copied unchanged.
+ *
+ * @param str   UTF-8 string to fold
+ * @return      case folded UTF-8 string
+ */
+static inline std::string utf8_casefold(const string_ref& str)
+{
+    std::string out;
+    out.reserve(str.size());
+
+    const char* p = str.begin(), * end = str.end();
+    while (p != end)
+    {
+        const char* q = find_non_ascii(p, end);
+        if (q != p) {
+            std::string::size_type n = out.size();
+            out.resize(n + static_cast<std::string::size_type>(q - p));
+            tolower_ascii(p, q, &out[n]);
+            p = q;
+        }
+        if (p == end) break;
+
+        utf8_encode(out, utf8_fold_codepoint(utf8_decode(p, end)));
+    }
+
+    return out;
+}
+
+/**
+ * Compare two UTF-8 strings case-insensitively using Unicode simple case
+ * folding. The common prefix is skipped by the SIMD ASCII compare kernels,
+ * only differing characters are decoded and folded. Returns 0 if they are
+ * equal, -1 if a is before b, +1 if a is after b, in the order of the folded
+ * code points.
+ */
+static inline int compare_icase_utf8(const string_ref& a, const string_ref& b)
+{
+    const char* pa = a.begin(), * ea = a.end();
+    const char* pb = b.begin(), * eb = b.end();
+
+    while (true)
+    {
+        size_t n = static_cast<size_t>(std::min(ea - pa, eb - pb));
+        size_t i = mismatch_icase(pa, pb, n);
+
+        if (i == n) {
+            if (pa + n != ea) return +1;
+            if (pb + n != eb) return -1;
+            return 0;
+        }
+
+        // back up to the start of the UTF-8 sequence containing the mismatch
+        while (i > 0 && ((pa[i] & 0xC0) == 0x80 || (pb[i] & 0xC0) == 0x80))
+            --i;
+        pa += i, pb += i;
+
+        unsigned int ca = utf8_fold_codepoint(utf8_decode(pa, ea));
+        unsigned int cb = utf8_fold_codepoint(utf8_decode(pb, eb));
+        if (ca != cb) return (ca < cb) ? -1 : +1;
+    }
+}
+
+/**
+ * Compare two UTF-8 strings case-insensitively using Unicode simple case
+ * folding. Return true if they are equal.
+ */
+static inline bool equal_icase_utf8(const string_ref& a, const string_ref& b)
+{
+    return compare_icase_utf8(a, b) == 0;
+}
+
+/**
+ * Compare two UTF-8 strings case-insensitively using Unicode simple case
+ * folding. Return true if a is less than b.
+ */
+static inline bool less_icase_utf8(const string_ref& a, const string_ref& b)
+{
+    return compare_icase_utf8(a, b) < 0;
+}
+
+/**
+ * Hash a UTF-8 string case-insensitively, consistent with equal_icase_utf8().
+ * Pure ASCII strings are hashed directly by hash_icase(), others are case
+ * folded first.
+ *
+ * @param data  start of the UTF-8 string
+ * @param size  length of the UTF-8 string
+ * @return      64-bit hash value
+ */
+static inline unsigned long long hash_icase_utf8(const char* data, size_t size)
+{
+    if (find_non_ascii(data, data + size) == data + size)
+        return hash_icase(data, size);
+
+    std::string folded = utf8_casefold(string_ref(data, size));
+    return hash_icase(folded.data(), folded.size());
+}
+
+/**
+ * Case-insensitive UTF-8 hash functional class for std::unordered_map and
+ * others, matching equal_icase_utf8() and icase_utf8_equal. It is
+ * transparent like icase_hash.
+ */
+struct icase_utf8_hash
+{
+    typedef void is_transparent;
+
+    inline size_t operator()(const string_ref& str) const {
+        return static_cast<size_t>(hash_icase_utf8(str.data(), str.size()));
+    }
+};
+
+/**
+ * Case-insensitive UTF-8 equality functional class for std::unordered_map and
+ * others, matching equal_icase_utf8() and icase_utf8_hash. It is transparent
+ * like icase_equal.
+ */
+struct icase_utf8_equal
+{
+    typedef void is_transparent;
+
+    inline bool operator()(const string_ref& a, const string_ref& b) const {
+        return compare_icase_utf8(a, b) == 0;
+    }
+};
+
+/**
+ * Match the case folded UTF-8 string against the beginning of [p,end), folding
+ * the characters of the range. Returns the end of the match or NULL.
+ */
+static inline const char* utf8_match_folded(const char* p, const char* end, const std::string& folded)
+{
+    const char* q = folded.data(), * qe = folded.data() + folded.size();
+    while (q != qe)
+    {
+        if (p == end) return NULL;
+        if (!(*p & 0x80)) {
+            if (ascii_tolower(*p) != *q) return NULL;
+            ++p, ++q;
+        }
+        else if (utf8_fold_codepoint(utf8_decode(p, end)) != utf8_decode(q, qe)) {
+            return NULL;
+        }
+    }
+    return p;
+}
+
+/**
+ * Find the first occurrence of needle in the UTF-8 haystack case-insensitively
+ * using Unicode simple case folding, starting at byte position pos. Candidate
+ * positions are located by the scanning kernels. Returns the byte position of
+ * the match, or std::string::npos.
+ *
+ * @param haystack      UTF-8 string to search in
+ * @param needle        UTF-8 string to search for
+ * @param pos           byte position to start searching at
+ * @return              byte position of the match, or npos
+ */
+static inline std::string::size_type find_icase_utf8(const string_ref& haystack, const string_ref& needle, std::string::size_type pos = 0)
+{
+    if (pos > haystack.size()) return std::string::npos;
+    if (needle.empty()) return pos;
+
+    std::string folded = utf8_casefold(needle);
+
+    // characters folding to the first needle character start with one of
+    // its cases, or with a non-ASCII byte
+    char_set first;
+    for (unsigned int c = (folded[0] & 0x80) ? 0x80 : 0xC0; c < 0x100; ++c)
+        first.insert(static_cast<char>(c));
+    if (!(folded[0] & 0x80))
+        first.insert(folded[0]).insert(ascii_toupper(folded[0]));
+
+    const char* p = haystack.begin() + pos, * end = haystack.end();
+    while ((p = find_any(p, end, first)) != end)
+    {
+        if (utf8_match_folded(p, end, folded))
+            return static_cast<std::string::size_type>(p - haystack.begin());
+        ++p;
+    }
+
+    return std::string::npos;
+}
+
+// ***                                        ***
+// *** String Stream Transformation Functions ***
+// ***                                        ***
+
+/**
+ * Template transformation function which uses std::ostringstream to serialize
+ * any ostreamable type into a std::string.
+ */
+template <typename Type>
+static inline std::string to_str(const Type& val)
+{
+    std::ostringstream os;
+    os << val;
+    return os.str();
+}
+
+/**
+ * Template transformation function which uses std::istringstream to parse any
+ * istreamable type from a std::string.
+ */
+template <typename Type>
+static inline bool from_str(const std::string& str, Type& outval)
+{
+    std::istringstream is(str);
+    is >> outval;
+    return is.eof();
+}
+
+// ***                             ***
+// *** Prefix and Suffix Functions ***
+// ***                             ***
+
+/**
+ * Checks if the given match string is located at the start of this string.
+ */
+static inline bool is_prefix(const std::string& str, const std::string& match)
+{
+    if (match.size() > str.size()) return false;
+    return std::equal( match.begin(), match.end(), str.begin() );
+}
+
+/**
+ * Checks if the given match string is located at the end of this string.
+ */
+static inline bool is_suffix(const std::string& str, const std::string& match)
+{
+    if (match.size() > str.size()) return false;
+    return std::equal( match.begin(), match.end(),
+                       str.end() - match.size() );
+}
+
+/**
+ * Checks if the given match string is located at the start of this
+ * string. Compares the characters case-insensitively.
+ */
+static inline bool is_prefix_icase(const std::string& str, const std::string& match)
+{
+    if (match.size() > str.size()) return false;
+    return memcmp_icase(str.data(), match.data(), match.size()) == 0;
+}
+
+/**
+ * Checks if the given match string is located at the end of this
+ * string. Compares the characters case-insensitively.
+ */
+static inline bool is_suffix_icase(const std::string& str, const std::string& match)
+{
+    if (match.size() > str.size()) return false;
+    return memcmp_icase(str.data() + str.size() - match.size(),
+                        match.data(), match.size()) == 0;
+}
+
+// ***                            ***
+// *** Substring Search Functions ***
+// ***                            ***
+
+/*
+ * Needles of at least this length are searched with the Two-Way algorithm,
+ * shorter ones by the SIMD first and last byte prefilter.
+ */
+static const size_t search_two_way_min = 256;
+
+//! canonical form of a byte for the substring searches
+template <bool FoldCase>
+static inline char search_canon(char c)
+{
+    return FoldCase ? scan_fold_ascii(c) : c;
+}
+
+/**
+ * Precomputed Two-Way tables of a needle: the critical factorization and a
+ * bad-character shift table on the window's last byte.
+ */
+struct two_way_table
+{
+    //! start of the right half of the critical factorization
+    size_t suffix;
+
+    //! shift after the right half matched
+    size_t period;
+
+    //! whether the left half repeats with the needle's period
+    bool periodic;
+
+    //! distance of each byte's last occurrence to the needle's end
+    size_t shift[256];
+};
+
+/**
+ * Compute the maximal suffix of the needle x of length n for the byte order,
+ * or the reverse order. Returns the suffix start minus one, and its period.
+ */
+template <bool FoldCase>
+static inline size_t two_way_max_suffix(const char* x, size_t n, bool reverse, size_t& period)
+{
+    // the index of the suffix start minus one wraps around from npos
+    size_t ms = static_cast<size_t>(-1), j = 0, k = 1;
+    period = 1;
+
+    while (j + k < n)
+    {
+        unsigned char a = static_cast<unsigned char>(search_canon<FoldCase>(x[j + k]));
+        unsigned char b = static_cast<unsigned char>(search_canon<FoldCase>(x[ms + k]));
+        if (reverse ? a > b : a < b) {
+            j += k, k = 1, period = j - ms;
+        }
+        else if (a == b) {
+            if (k != period) ++k;
+            else j += period, k = 1;
+        }
+        else {
+            ms = j++, k = period = 1;
+        }
+    }
+    return ms;
+}
+
+/**
+ * Compute the Two-Way tables of the needle x of length n >= 1, comparing
+ * bytes in canonical form.
+ */
+template <bool FoldCase>
+static inline void two_way_compile(const char* x, size_t n, two_way_table& t)
+{
+    size_t p1, p2;
+    size_t ms1 = two_way_max_suffix<FoldCase>(x, n, false, p1);
+    size_t ms2 = two_way_max_suffix<FoldCase>(x, n, true, p2);
+
+    // the later of both suffixes is a critical factorization
+    if (ms2 + 1 < ms1 + 1)
+        t.suffix = ms1 + 1, t.period = p1;
+    else
+        t.suffix = ms2 + 1, t.period = p2;
+
+    t.periodic = (t.suffix + t.period <= n);
+    for (size_t i = 0; t.periodic && i < t.suffix; ++i)
+        t.periodic = (search_canon<FoldCase>(x[i]) == search_canon<FoldCase>(x[i + t.period]));
+
+    if (!t.periodic)
+        t.period = std::max(t.suffix, n - t.suffix) + 1;
+
+    std::fill(t.shift, t.shift + 256, n);
+    for (size_t i = 0; i < n; ++i)
+        t.shift[static_cast<unsigned char>(search_canon<FoldCase>(x[i]))] = n - 1 - i;
+}
+
+/**
+ * Two-Way search of the needle x of length n >= 1 in [begin,end), in linear
+ * time. Returns a pointer to the first match, or end.
+ */
+template <bool FoldCase>
+static inline const char* two_way_search(const char* begin, const char* end,
+                                         const char* x, size_t n, const two_way_table& t)
+{
+    size_t size = static_cast<size_t>(end - begin);
+    if (size < n) return end;
+
+    // number of bytes at the start of the window known to match from the
+    // previous periodic shift
+    size_t memory = 0;
+
+    for (size_t j = 0; j <= size - n; )
+    {
+        size_t shift = t.shift[static_cast<unsigned char>(
+                                   search_canon<FoldCase>(begin[j + n - 1]))];
+        if (shift != 0)
+        {
+            // a periodic needle cannot match before the mismatching byte
+            // leaves the window
+            if (t.periodic && memory != 0 && shift < t.period)
+                shift = n - t.period;
+            memory = 0;
+            j += shift;
+            continue;
+        }
+
+        // match the right half, the last byte matched by the shift table
+        size_t i = std::max(t.suffix, memory);
+        while (i < n - 1 && search_canon<FoldCase>(x[i]) ==
+               search_canon<FoldCase>(begin[i + j]))
+            ++i;
+
+        if (i < n - 1) {
+            j += i - t.suffix + 1;
+            memory = 0;
+            continue;
+        }
+
+        // match the left half from right to left
+        i = t.suffix;
+        while (i > memory && search_canon<FoldCase>(x[i - 1]) ==
+               search_canon<FoldCase>(begin[i - 1 + j]))
+            --i;
+
+        if (i <= memory)
+            return begin + j;
+
+        j += t.period;
+        memory = t.periodic ? n - t.period : 0;
+    }
+
+    return end;
+}
+
+/**
+ * Search the needle x of length n >= 1 in [begin,end) by locating candidate
+ * positions with the first and last needle byte using the scanning kernels,
+ * and verifying the bytes in between. Returns a pointer to the first match,
+ * or end. Each verification may cost up to n byte comparisons, hence the
+ * verified bytes are counted: once they exceed twice the scanned distance
+ * plus a constant, the search stops, sets begin to the position to continue
+ * from and returns NULL, so the caller can finish with two_way_search() in
+ * linear time.
+ */
+template <bool FoldCase>
+static inline const char* search_prefilter(const char*& begin, const char* end,
+                                           const char* x, size_t n)
+{
+    if (static_cast<size_t>(end - begin) < n) return end;
+
+    char first = search_canon<FoldCase>(x[0]), last = search_canon<FoldCase>(x[n - 1]);
+    const char* cend = end - n + 1;
+    const char* start = begin;
+    size_t work = 0;
+
+    for (const char* p = begin; ; ++p)
+    {
+        p = FoldCase ? find_pair_icase(p, cend, first, last, n - 1)
+            : find_pair(p, cend, first, last, n - 1);
+        if (p == cend) return end;
+
+        if (n <= 2) return p;
+        if (FoldCase) {
+            size_t m = mismatch_icase(p + 1, x + 1, n - 2);
+            if (m == n - 2) return p;
+            work += m + 1;
+        }
+        else {
+            if (memcmp(p + 1, x + 1, n - 2) == 0) return p;
+            work += n - 2;
+        }
+
+        if (work > 2 * static_cast<size_t>(p - start) + 4 * search_two_way_min) {
+            begin = p + 1;
+            return NULL;
+        }
+    }
+}
+
+// *** Precompiled Searcher Class ***
+
+/**
+ * Substring search with the needle preprocessed once. The constructor
+ * selects the search method and builds the Two-Way tables, hence repeated
+ * searches for the same needle in many haystacks do not pay the setup on
+ * each call. Single byte needles are
+ * located with find_char(), short needles by search_prefilter(), and long
+ * needles with the Two-Way algorithm of Crochemore and Perrin, which runs in
+ * linear time and constant extra space. The prefilter falls back to Two-Way
+ * on inputs with many candidate positions, hence all searches run in linear
+ * time. With fold_case the ASCII letters match case-insensitively. The
+ * search position lives on the caller's stack, so concurrent find() calls
+ * on one searcher need no locking.
+ */
+class searcher
+{
+public:
+    /**
+     * Compile a needle.
+     *
+     * @param needle        string to search for
+     * @param fold_case     match the needle case-insensitively
+     */
+    explicit searcher(const std::string& needle, bool fold_case = false)
+        : m_needle(needle), m_fold_case(fold_case)
+    {
+        if (m_fold_case) {
+            for (size_t i = 0; i < m_needle.size(); ++i)
+                m_needle[i] = scan_fold_ascii(m_needle[i]);
+        }
+
+        if (m_needle.empty())
+            m_method = method_empty;
+        else if (m_needle.size() == 1)
+            m_method = method_byte;
+        else if (m_needle.size() < search_two_way_min)
+            m_method = method_pair;
+        else
+            m_method = method_two_way;
+
+        // the needle is folded already, compare it as is
+        if (m_needle.size() >= 2)
+            two_way_compile<false>(m_needle.data(), m_needle.size(), m_two_way);
+    }
+
+    //! length of the needle
+    size_t size() const { return m_needle.size(); }
+
+    //! whether ASCII letters match case-insensitively
+    bool fold_case() const { return m_fold_case; }
+
+    /**
+     * Find the first occurrence of the needle in [begin,end). An empty needle
+     * matches at begin.
+     *
+     * @param begin         start of range to search in
+     * @param end           end of range to search in
+     * @return              pointer to the first match, or end
+     */
+    const char* search(const char* begin, const char* end) const
+    {
+        return m_fold_case ? search_method<true>(begin, end)
+               : search_method<false>(begin, end);
+    }
+
+    /**
+     * Search for the needle like std::string::find().
+     *
+     * @param haystack      string to search in
+     * @param pos           position to start search
+     * @return              position of the first match at or after pos, or npos
+     */
+    std::string::size_type find(const string_ref& haystack, std::string::size_type pos = 0) const
+    {
+        if (pos > haystack.size())
+            return std::string::npos;
+
+        const char* end = haystack.data() + haystack.size();
+        const char* p = search(haystack.data() + pos, end);
+
+        if (p == end && !m_needle.empty())
+            return std::string::npos;
+
+        return static_cast<std::string::size_type>(p - haystack.data());
+    }
+
+private:
+    //! search methods selected by the constructor
+    enum method { method_empty, method_byte, method_pair, method_two_way };
+
+    //! the needle, ASCII letters folded to lowercase with fold_case
+    std::string m_needle;
+
+    //! whether ASCII letters match case-insensitively
+    bool m_fold_case;
+
+    //! selected search method
+    method m_method;
+
+    //! Two-Way tables of needles with at least two bytes
+    two_way_table m_two_way;
+
+    //! search with the selected method
+    template <bool FoldCase>
+    const char* search_method(const char* begin, const char* end) const
+    {
+        const char* x = m_needle.data();
+        size_t n = m_needle.size();
+
+        if (static_cast<size_t>(end - begin) < n) return end;
+
+        switch (m_method)
+        {
+        case method_empty:
+            return begin;
+
+        case method_byte:
+            if (FoldCase && x[0] >= 'a' && x[0] <= 'z')
+                return find_pair_icase(begin, end, x[0], x[0], 0);
+            return find_char(begin, end, x[0]);
+
+        case method_pair: {
+            const char* p = search_prefilter<FoldCase>(begin, end, x, n);
+            if (p != NULL) return p;
+            return two_way_search<FoldCase>(begin, end, x, n, m_two_way);
+        }
+
+        default:
+            return two_way_search<FoldCase>(begin, end, x, n, m_two_way);
+        }
+    }
+};
+
+// ***                              ***
+// *** Search and Replace Functions ***
+// ***                              ***
+
+/**
+ * Adapter giving a plain needle string the find() and size() interface of
+ * searcher, which the replace algorithms are written against.
+ */
+class replace_str_needle
+{
+public:
+    //! wrap the needle string, which must outlive the adapter
+    explicit replace_str_needle(const std::string& needle)
+        : m_needle(needle)
+    { }
+
+    //! find the needle in str starting at pos using std::string::find()
+    std::string::size_type find(const std::string& str, std::string::size_type pos) const
+    {
+        return str.find(m_needle, pos);
+    }
+
+    //! length of the needle
+    size_t size() const { return m_needle.size(); }
+
+private:
+    //! the needle string
+    const std::string& m_needle;
+};
+
+/**
+ * Replace only the first occurrence of needle in str. The needle will be
+ * replaced with instead, if found. Returns a copy of the string with the
+ * possible replacement.
+ *
+ * @param str           the string to process
+ * @param needle        string to search for in str
+ * @param instead       replace needle with instead
+ * @return              copy of string possibly with replacement
+ */
+static inline std::string replace_first(const std::string& str, const std::string& needle, const std::string& instead)
+{
+    std::string newstr = str;
+    std::string::size_type firstpos = newstr.find(needle);
+
+    if ( firstpos != std::string::npos)
+        newstr.replace(firstpos, needle.size(), instead);
+
+    return newstr;
+}
+
+/**
+ * Replace only the first occurrence of the compiled needle in str, see
+ * replace_first() above.
+ *
+ * @param str           the string to process
+ * @param needle        compiled needle to search for in str
+ * @param instead       replace needle with instead
+ * @return              copy of string possibly with replacement
+ */
+static inline std::string replace_first(const std::string& str, const searcher& needle, const std::string& instead)
+{
+    std::string newstr = str;
+    std::string::size_type firstpos = needle.find(newstr);
+
+    if ( firstpos != std::string::npos)
+        newstr.replace(firstpos, needle.size(), instead);
+
+    return newstr;
+}
+
+/**
+ * Count the non-overlapping occurrences of a non-empty needle in str, from
+ * left to right as replace_all() replaces them.
+ */
+template <typename Needle>
+static inline std::string::size_type replace_all_count(const std::string& str, const Needle& needle)
+{
+    std::string::size_type count = 0, pos = 0;
+
+    while ( (pos = needle.find(str, pos)) != std::string::npos)
+    {
+        ++count;
+        pos += needle.size();
+    }
+    return count;
+}
+
+/**
+ * Replace all occurrences of needle in str, which is a replace_str_needle or
+ * a searcher. The matches are counted first to size the result exactly,
+ * which is then built in one forward pass. An empty needle matches nothing.
+ */
+template <typename Needle>
+static inline std::string replace_all_algorithm(const std::string& str, const Needle& needle, const std::string& instead)
+{
+    if (needle.size() == 0) return str;
+
+    std::string::size_type count = replace_all_count(str, needle);
+    if (count == 0) return str;
+
+    std::string newstr;
+    newstr.reserve(str.size() - count * needle.size() + count * instead.size());
+
+    std::string::size_type lastpos = 0, thispos;
+
+    while ( (thispos = needle.find(str, lastpos)) != std::string::npos)
+    {
+        newstr.append(str, lastpos, thispos - lastpos);
+        newstr.append(instead);
+        lastpos = thispos + needle.size();
+    }
+    newstr.append(str, lastpos, std::string::npos);
+
+    return newstr;
+}
+
+/**
+ * Replace all occurrences of needle in str in place, see
+ * replace_all_inplace(). If instead is not longer than needle, the string is
+ * compacted in one forward pass, otherwise the result is built like
+ * replace_all().
+ */
+template <typename Needle>
+static inline std::string& replace_all_inplace_algorithm(std::string& str, const Needle& needle, const std::string& instead)
+{
+    if (needle.size() == 0) return str;
+
+    if (instead.size() > needle.size()) {
+        std::string newstr = replace_all_algorithm(str, needle, instead);
+        str.swap(newstr);
+        return str;
+    }
+
+    // the write position never passes the read position, hence the
+    // remaining string is searched unmodified
+    std::string::size_type lastpos = 0, thispos, writepos = 0;
+
+    while ( (thispos = needle.find(str, lastpos)) != std::string::npos)
+    {
+        if (writepos != lastpos)
+            memmove(&str[writepos], str.data() + lastpos, thispos - lastpos);
+        writepos += thispos - lastpos;
+
+        if (!instead.empty())
+            memcpy(&str[writepos], instead.data(), instead.size());
+        writepos += instead.size();
+
+        lastpos = thispos + needle.size();
+    }
+
+    if (writepos != lastpos) {
+        memmove(&str[writepos], str.data() + lastpos, str.size() - lastpos);
+        str.resize(writepos + str.size() - lastpos);
+    }
+
+    return str;
+}
+
+/**
+ * Replace all occurrences of needle in str. Each needle will be replaced with
+ * instead, if found. Returns a copy of the string with possible replacements.
+ * The matches are counted first to size the result exactly, which is then
+ * built in one forward pass. An empty needle matches nothing.
+ *
+ * @param str           the string to process
+ * @param needle        string to search for in str
+ * @param instead       replace needle with instead
+ * @return              copy of string possibly with replacements
+ */
+static inline std::string replace_all(const std::string& str, const std::string& needle, const std::string& instead)
+{
+    return replace_all_algorithm(str, replace_str_needle(needle), instead);
+}
+
+/**
+ * Replace all occurrences of the compiled needle in str, see replace_all()
+ * above.
+ *
+ * @param str           the string to process
+ * @param needle        compiled needle to search for in str
+ * @param instead       replace needle with instead
+ * @return              copy of string possibly with replacements
+ */
+static inline std::string replace_all(const std::string& str, const searcher& needle, const std::string& instead)
+{
+    return replace_all_algorithm(str, needle, instead);
+}
+
+/**
+ * Replace only the first occurrence of needle in str. The needle will be
+ * replaced with instead, if found. The replacement is done in the given string
+ * and a reference to the same is returned.
+ *
+ * @param str           the string to process
+ * @param needle        string to search for in str
+ * @param instead       replace needle with instead
+ * @return              reference to str
+ */
+static inline std::string& replace_first_inplace(std::string& str, const std::string& needle, const std::string& instead)
+{
+    std::string::size_type firstpos = str.find(needle);
+
+    if ( firstpos != std::string::npos)
+        str.replace(firstpos, needle.size(), instead);
+
+    return str;
+}
+
+/**
+ * Replace all occurrences of needle in str. Each needle will be replaced with
+ * instead, if found. The replacement is done in the given string and a
+ * reference to the same is returned. If instead is not longer than needle,
+ * the string is compacted in place in one forward pass, otherwise the result
+ * is built like replace_all(). An empty needle matches nothing.
+ *
+ * @param str           the string to process
+ * @param needle        string to search for in str
+ * @param instead       replace needle with instead
+ * @return              reference to str
+ */
+static inline std::string& replace_all_inplace(std::string& str, const std::string& needle, const std::string& instead)
+{
+    return replace_all_inplace_algorithm(str, replace_str_needle(needle), instead);
+}
+
+/**
+ * Replace all occurrences of the compiled needle in str in place, see
+ * replace_all_inplace() above.
+ *
+ * @param str           the string to process
+ * @param needle        compiled needle to search for in str
+ * @param instead       replace needle with instead
+ * @return              reference to str
+ */
+static inline std::string& replace_all_inplace(std::string& str, const searcher& needle, const std::string& instead)
+{
+    return replace_all_inplace_algorithm(str, needle, instead);
+}
+
+/**
+ * Aho-Corasick multi-pattern replacer. It replaces occurrences of any of a
+ * set of needles with their respective replacement in one pass over the input,
+ * instead of one replace_all() pass per needle. Matches are chosen
+ * leftmost-longest: among overlapping matches the one starting first wins,
+ * and of those the longest. Unlike chained replace_all() calls, replaced text
+ * is never searched again.
+ *
+ * The needles are compiled into an Aho-Corasick automaton, stored as dense
+ * DFA over the byte classes which occur in the needles, hence the table stays
+ * small. With fold_case the ASCII letters match case-insensitively.
+ * replace() walks the automaton with a local state and never modifies it,
+ * hence one replacer can serve several threads at once.
+ */
+class multi_replacer
+{
+public:
+    /**
+     * Compile a map of needles to replacements. Empty needles are ignored,
+     * as are needles equal to earlier ones with fold_case.
+     *
+     * @param replacements  map from needles to their replacements
+     * @param fold_case     match needles case-insensitively
+     */
+    explicit multi_replacer(const std::map<std::string, std::string>& replacements,
+                            bool fold_case = false)
+    {
+        compile(replacements.begin(), replacements.end(), fold_case);
+    }
+
+    /**
+     * Compile a range of pairs of needles and replacements, see above.
+     *
+     * @param begin         iterator to the first pair
+     * @param end           iterator beyond the last pair
+     * @param fold_case     match needles case-insensitively
+     */
+    template <typename Iterator>
+    multi_replacer(Iterator begin, Iterator end, bool fold_case = false)
+    {
+        compile(begin, end, fold_case);
+    }
+
+    //! number of needles compiled
+    size_t size() const { return m_replacement.size(); }
+
+    //! number of automaton states
+    size_t states() const { return m_depth.size(); }
+
+    /**
+     * Replace all needles in str and append the result to out.
+     *
+     * @param str           the string to process
+     * @param out           string to append the result to
+     */
+    void replace(const string_ref& str, std::string& out) const
+    {
+        const char* p = str.data();
+        size_t n = str.size();
+
+        // start of input not yet copied, and the best match so far
+        size_t copied = 0, best_start = 0, best_end = 0;
+        int best = -1;
+
+        size_t i = 0;
+        unsigned int state = 0;
+
+        while (true)
+        {
+            if (i < n) {
+                state = m_delta[state * m_classes + m_class[static_cast<unsigned char>(p[i])]];
+                ++i;
+
+                int o = m_output[state];
+                if (o >= 0)
+                {
+                    size_t start = i - m_needle_size[o];
+                    if (best < 0 || start < best_start ||
+                        (start == best_start && i > best_end))
+                    {
+                        best = o, best_start = start, best_end = i;
+                    }
+                }
+
+                // later matches cannot start before the current state's string
+                if (best < 0 || i - m_depth[state] <= best_start)
+                    continue;
+            }
+            else if (best < 0) {
+                break;
+            }
+
+            out.append(p + copied, best_start - copied);
+            out.append(m_replacement[best]);
+
+            // restart the automaton after the match
+            copied = i = best_end;
+            state = 0;
+            best = -1;
+        }
+
+        out.append(p + copied, n - copied);
+    }
+
+    /**
+     * Replace all needles in str and return a copy of the result.
+     *
+     * @param str           the string to process
+     * @return              copy of string possibly with replacements
+     */
+    std::string replace(const string_ref& str) const
+    {
+        std::string out;
+        out.reserve(str.size());
+        replace(str, out);
+        return out;
+    }
+
+private:
+    //! build the automaton from a range of pairs of needles and replacements
+    template <typename Iterator>
+    void compile(Iterator begin, Iterator end, bool fold_case)
+    {
+        // assign a class to each byte occurring in a needle, all others
+        // share class zero
+        std::vector<unsigned int> key_class(256, 0);
+        m_classes = 1;
+
+        for (Iterator it = begin; it != end; ++it)
+        {
+            const std::string& needle = it->first;
+            for (size_t j = 0; j < needle.size(); ++j)
+            {
+                unsigned char c = static_cast<unsigned char>(needle[j]);
+                if (fold_case) c = ascii_case_tables<>::lower[c];
+                if (key_class[c] == 0) key_class[c] = m_classes++;
+            }
+        }
+
+        for (unsigned int c = 0; c < 256; ++c) {
+            m_class[c] = static_cast<unsigned short>(
+                key_class[fold_case ? ascii_case_tables<>::lower[c] : c]);
+        }
+
+        // insert the needles into a trie, child zero means none
+        m_delta.assign(m_classes, 0);
+        m_depth.assign(1, 0);
+        m_output.assign(1, -1);
+
+        for (Iterator it = begin; it != end; ++it)
+        {
+            const std::string& needle = it->first;
+            if (needle.empty()) continue;
+
+            unsigned int state = 0;
+            for (size_t j = 0; j < needle.size(); ++j)
+            {
+                size_t t = state * m_classes + m_class[static_cast<unsigned char>(needle[j])];
+                if (m_delta[t] == 0) {
+                    m_delta[t] = static_cast<unsigned int>(m_depth.size());
+                    m_depth.push_back(m_depth[state] + 1);
+                    m_output.push_back(-1);
+                    m_delta.resize(m_delta.size() + m_classes, 0);
+                }
+                state = m_delta[t];
+            }
+
+            if (m_output[state] < 0) {
+                m_output[state] = static_cast<int>(m_replacement.size());
+                m_needle_size.push_back(needle.size());
+                m_replacement.push_back(it->second);
+            }
+        }
+
+        // breadth-first over the trie: compute failure links, complete the
+        // transitions to a DFA and inherit the longest output of the
+        // failure state
+        std::vector<unsigned int> fail(m_depth.size(), 0);
+        std::vector<unsigned int> queue;
+        queue.reserve(m_depth.size());
+
+        for (unsigned int c = 0; c < m_classes; ++c) {
+            if (m_delta[c] != 0) queue.push_back(m_delta[c]);
+        }
+
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            unsigned int s = queue[q];
+            if (m_output[s] < 0) m_output[s] = m_output[fail[s]];
+
+            for (unsigned int c = 0; c < m_classes; ++c)
+            {
+                unsigned int& t = m_delta[s * m_classes + c];
+                unsigned int f = m_delta[fail[s] * m_classes + c];
+                if (t != 0) {
+                    fail[t] = f;
+                    queue.push_back(t);
+                }
+                else {
+                    t = f;
+                }
+            }
+        }
+    }
+
+    //! byte class of each byte
+    unsigned short m_class[256];
+
+    //! number of byte classes
+    unsigned int m_classes;
+
+    //! DFA transitions: next state for each state and byte class
+    std::vector<unsigned int> m_delta;
+
+    //! length of the string each state represents
+    std::vector<size_t> m_depth;
+
+    //! longest needle which is a suffix of each state's string, or -1
+    std::vector<int> m_output;
+
+    //! length of each needle
+    std::vector<size_t> m_needle_size;
+
+    //! replacement of each needle
+    std::vector<std::string> m_replacement;
+};
+
+// ***                   ***
+// *** Tokenizer Classes ***
+// ***                   ***
+
+/**
+ * Tokenizer which splits a character range by whitespaces like split_ws(). Each
+ * call to next() scans only up to the end of the following word. Multiple
+ * consecutive whitespaces are considered as one split point. After limit - 1
+ * words, the remainder of the range is returned as the last part.
+ */
+class split_ws_tokenizer
+{
+public:
+    //! construct a tokenizer over an empty range
+    split_ws_tokenizer()
+        : m_pos(NULL), m_end(NULL), m_limit(0)
+    { }
+
+    //! initialize tokenizer for the characters [begin,end)
+    split_ws_tokenizer(const char* begin, const char* end,
+                       std::string::size_type limit = std::string::npos)
+        : m_pos(begin), m_end(end), m_limit(limit)
+    { }
+
+    //! find the next word, returns false if none is left
+    bool next(string_ref& token)
+    {
+        if (m_limit == 0) return false;
+
+        // skip over whitespace
+        m_pos = find_not_split_ws(m_pos, m_end);
+        if (m_pos == m_end) return false;
+
+        const char* it = find_split_ws(m_pos, m_end);
+
+        if (it == m_end || m_limit == 1) {
+            token = string_ref(m_pos, m_end);
+            m_pos = m_end;
+        }
+        else {
+            token = string_ref(m_pos, it);
+            m_pos = it + 1;
+        }
+
+        --m_limit;
+        return true;
+    }
+
+private:
+    //! current scan position and end of range
+    const char* m_pos, * m_end;
+
+    //! remaining number of parts
+    std::string::size_type m_limit;
+};
+
+/**
+ * Tokenizer which splits a character range at each separator character like
+ * split(). Multiple consecutive separators result in empty parts, however an
+ * empty part after a trailing separator is not returned. After limit - 1
+ * parts, the remainder of the range is returned as the last part.
+ */
+class split_tokenizer
+{
+public:
+    //! construct a tokenizer over an empty range
+    split_tokenizer()
+        : m_pos(NULL), m_end(NULL), m_sep(0), m_limit(0)
+    { }
+
+    //! initialize tokenizer for the characters [begin,end)
+    split_tokenizer(const char* begin, const char* end, char sep,
+                    std::string::size_type limit = std::string::npos)
+        : m_pos(begin), m_end(end), m_sep(sep), m_limit(limit)
+    { }
+
+    //! find the next part, returns false if none is left
+    bool next(string_ref& token)
+    {
+        if (m_limit == 0 || m_pos == m_end) return false;
+
+        const char* it = find_char(m_pos, m_end, m_sep);
+
+        if (it == m_end || m_limit == 1) {
+            token = string_ref(m_pos, m_end);
+            m_pos = m_end;
+        }
+        else {
+            token = string_ref(m_pos, it);
+            m_pos = it + 1;
+        }
+
+        --m_limit;
+        return true;
+    }
+
+private:
+    //! current scan position and end of range
+    const char* m_pos, * m_end;
+
+    //! separator character
+    char m_sep;
+
+    //! remaining number of parts
+    std::string::size_type m_limit;
+};
+
+/**
+ * Tokenizer which splits a character range at each character contained in a
+ * character set like split_any(). If collapse is false, multiple consecutive
+ * separators result in empty parts, however an empty part after a trailing
+ * separator is not returned. If collapse is true, multiple consecutive
+ * separators are considered as one split point like in split_ws(). After
+ * limit - 1 parts, the remainder of the range is returned as the last part.
+ */
+class split_set_tokenizer
+{
+public:
+    //! construct a tokenizer over an empty range
+    split_set_tokenizer()
+        : m_pos(NULL), m_end(NULL), m_collapse(false), m_limit(0)
+    { }
+
+    //! initialize tokenizer for the characters [begin,end)
+    split_set_tokenizer(const char* begin, const char* end,
+                        const char_set& set, bool collapse,
+                        std::string::size_type limit = std::string::npos)
+        : m_pos(begin), m_end(end), m_set(set), m_collapse(collapse),
+          m_limit(limit)
+    { }
+
+    //! find the next part, returns false if none is left
+    bool next(string_ref& token)
+    {
+        if (m_limit == 0 || m_pos == m_end) return false;
+
+        if (m_collapse) {
+            // skip over separators
+            m_pos = find_not_any(m_pos, m_end, m_set);
+            if (m_pos == m_end) return false;
+        }
+
+        const char* it = find_any(m_pos, m_end, m_set);
+
+        if (it == m_end || m_limit == 1) {
+            token = string_ref(m_pos, m_end);
+            m_pos = m_end;
+        }
+        else {
+            token = string_ref(m_pos, it);
+            m_pos = it + 1;
+        }
+
+        --m_limit;
+        return true;
+    }
+
+private:
+    //! current scan position and end of range
+    const char* m_pos, * m_end;
+
+    //! set of separator characters
+    char_set m_set;
+
+    //! skip empty parts
+    bool m_collapse;
+
+    //! remaining number of parts
+    std::string::size_type m_limit;
+};
+
+/**
+ * Tokenizer which splits a character range at each separator string like
+ * split(). Multiple consecutive separators result in empty parts. A separator
+ * is only recognized if at least one more character follows it. After limit -
+ * 1 parts, the remainder of the range is returned as the last part.
+ */
+class split_str_tokenizer
+{
+public:
+    //! construct a tokenizer over an empty range
+    split_str_tokenizer()
+        : m_pos(NULL), m_end(NULL), m_sep(NULL), m_seplen(0), m_limit(0)
+    { }
+
+    //! initialize tokenizer for the characters [begin,end)
+    split_str_tokenizer(const char* begin, const char* end,
+                        const char* sep, std::string::size_type seplen,
+                        std::string::size_type limit = std::string::npos)
+        : m_pos(begin), m_end(end), m_sep(sep), m_seplen(seplen),
+          m_limit(seplen == 0 ? 0 : limit)
+    { }
+
+    //! find the next part, returns false if none is left
+    bool next(string_ref& token)
+    {
+        if (m_limit == 0 || m_pos == m_end) return false;
+
+        const char* it = m_pos;
+
+        while (static_cast<std::string::size_type>(m_end - it) > m_seplen &&
+               !std::equal(m_sep, m_sep + m_seplen, it))
+            ++it;
+
+        if (static_cast<std::string::size_type>(m_end - it) <= m_seplen ||
+            m_limit == 1)
+        {
+            token = string_ref(m_pos, m_end);
+            m_pos = m_end;
+        }
+        else {
+            token = string_ref(m_pos, it);
+            m_pos = it + m_seplen;
+        }
+
+        --m_limit;
+        return true;
+    }
+
+private:
+    //! current scan position and end of range
+    const char* m_pos, * m_end;
+
+    //! separator string
+    const char* m_sep;
+
+    //! length of separator string
+    std::string::size_type m_seplen;
+
+    //! remaining number of parts
+    std::string::size_type m_limit;
+};
+
+/**
+ * Tokenizer splitting at each occurrence of a compiled separator, with the
+ * same results as split_str_tokenizer for the separator string.
+ */
+class split_searcher_tokenizer
+{
+public:
+    //! initialize tokenizer for the characters [begin,end)
+    split_searcher_tokenizer(const char* begin, const char* end,
+                             const searcher& sep,
+                             std::string::size_type limit = std::string::npos)
+        : m_pos(begin), m_end(end), m_sep(&sep),
+          m_limit(sep.size() == 0 ? 0 : limit)
+    { }
+
+    //! find the next part, returns false if none is left
+    bool next(string_ref& token)
+    {
+        if (m_limit == 0 || m_pos == m_end) return false;
+
+        // like split_str_tokenizer, a separator ending the range is not
+        // matched
+        const char* it = m_end;
+        if (static_cast<std::string::size_type>(m_end - m_pos) > m_sep->size()) {
+            it = m_sep->search(m_pos, m_end - 1);
+            if (it == m_end - 1) it = m_end;
+        }
+
+        if (it == m_end || m_limit == 1)
+        {
+            token = string_ref(m_pos, m_end);
+            m_pos = m_end;
+        }
+        else {
+            token = string_ref(m_pos, it);
+            m_pos = it + m_sep->size();
+        }
+
+        --m_limit;
+        return true;
+    }
+
+private:
+    //! current scan position and end of range
+    const char* m_pos, * m_end;
+
+    //! compiled separator
+    const searcher* m_sep;
+
+    //! remaining number of parts
+    std::string::size_type m_limit;
+};
+
+/**
+ * Forward iterator over the parts delivered by a tokenizer. The next part is
+ * searched for only when the iterator is advanced, hence iterating over the
+ * first few parts does not scan the whole string.
+ */
+template <typename Tokenizer>
+class token_iterator
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef string_ref value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const string_ref* pointer;
+    typedef const string_ref& reference;
+
+    //! construct the past-the-end iterator
+    token_iterator()
+        : m_valid(false)
+    { }
+
+    //! construct an iterator positioned at the first part of the tokenizer
+    explicit token_iterator(const Tokenizer& tokenizer)
+        : m_tokenizer(tokenizer)
+    {
+        m_valid = m_tokenizer.next(m_token);
+    }
+
+    reference operator * () const { return m_token; }
+
+    pointer operator -> () const { return &m_token; }
+
+    token_iterator& operator ++ ()
+    {
+        m_valid = m_tokenizer.next(m_token);
+        return *this;
+    }
+
+    token_iterator operator ++ (int)
+    {
+        token_iterator tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    //! iterators are equal if both are past-the-end or reference the same part
+    bool operator == (const token_iterator& other) const
+    {
+        if (!m_valid || !other.m_valid) return (m_valid == other.m_valid);
+        return m_token.data() == other.m_token.data() &&
+            m_token.size() == other.m_token.size();
+    }
+
+    bool operator != (const token_iterator& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    //! tokenizer state following the current part
+    Tokenizer m_tokenizer;
+
+    //! the current part
+    string_ref m_token;
+
+    //! false if past-the-end
+    bool m_valid;
+};
+
+/**
+ * Lazy range over the parts delivered by a tokenizer, usable with range-based
+ * for loops, std::distance() and other algorithms on forward iterators. The
+ * range references the original characters, which must outlive it.
+ */
+template <typename Tokenizer>
+class token_range
+{
+public:
+    typedef token_iterator<Tokenizer> iterator;
+    typedef token_iterator<Tokenizer> const_iterator;
+    typedef string_ref value_type;
+
+    explicit token_range(const Tokenizer& tokenizer)
+        : m_tokenizer(tokenizer)
+    { }
+
+    //! iterator to the first part
+    iterator begin() const { return iterator(m_tokenizer); }
+
+    //! past-the-end iterator
+    iterator end() const { return iterator(); }
+
+private:
+    //! tokenizer at the start of the range
+    Tokenizer m_tokenizer;
+};
+
+// ***                                ***
+// *** Extract and Contains Functions ***
+// ***                                ***
+
+/**
+ * Find the first occurrence of the needle in [begin,end) case-insensitively,
+ * folding only the ASCII letters. Short needles are located by
+ * search_prefilter(), long ones and inputs with many candidates by the
+ * Two-Way algorithm, hence the search runs in linear time. Returns end if the
+ * needle is not found.
+ *
+ * @param begin         start of range to search in
+ * @param end           end of range to search in
+ * @param needle        string to search for
+ * @param needlelen     length of search string
+ * @return              pointer to the first match, or end
+ */
+static inline const char* search_icase(const char* begin, const char* end, const char* needle, size_t needlelen)
+{
+    if (needlelen == 0) return begin;
+    if (needlelen > static_cast<size_t>(end - begin)) return end;
+
+    if (needlelen < search_two_way_min) {
+        const char* p = search_prefilter<true>(begin, end, needle, needlelen);
+        if (p != NULL) return p;
+    }
+
+    two_way_table table;
+    two_way_compile<true>(needle, needlelen, table);
+    return two_way_search<true>(begin, end, needle, needlelen, table);
+}
+
+/**
+ * Search for a substring like find() but case-insensitively, folding only the
+ * ASCII letters, see search_icase().
+ *
+ * @param haystack      string to search in
+ * @param pos           position to start search
+ * @param needle        string to search for
+ * @param needlelen     length of search string
+ */
+static inline std::string::size_type find_icase(const std::string& haystack, const char* needle, std::string::size_type pos, std::string::size_type needlelen)
+{
+    if (pos > haystack.size())
+        return std::string::npos;
+
+    const char* end = haystack.data() + haystack.size();
+    const char* p = search_icase(haystack.data() + pos, end, needle, needlelen);
+
+    if (p == end && needlelen != 0)
+        return std::string::npos;
+
+    return static_cast<std::string::size_type>(p - haystack.data());
+}
+
+/**
+ * Search for a substring like find() but case-insensitively.
+ *
+ * @param haystack      string to search in
+ * @param pos           position to start search
+ * @param needle        string to search for
+ */
+static inline std::string::size_type find_icase(const std::string& haystack, const std::string& needle, std::string::size_type pos = 0)
+{
+    return find_icase(haystack, needle.data(), pos, needle.size());
+}
+
+/**
+ * Search for a compiled needle like find() but case-insensitively. The
+ * searcher must have been compiled with fold_case.
+ *
+ * @param haystack      string to search in
+ * @param needle        compiled needle to search for
+ * @param pos           position to start search
+ */
+static inline std::string::size_type find_icase(const std::string& haystack, const searcher& needle, std::string::size_type pos = 0)
+{
+    if (!needle.fold_case())
+        throw(std::runtime_error("find_icase() requires a searcher compiled with fold_case"));
+
+    return needle.find(haystack, pos);
+}
+
+/**
+ * Search the given string for a whitespace-delimited word. It works as if the
+ * str was split_ws() and the resulting vector checked for a given
+ * word. However this function does not create a vector, it scans the string
+ * directly. Whitespace is space, tab, newline or carriage-return. To check
+ * for many words at once, use word_matcher.
+ *
+ * @param str   whitespace-delimited string to check
+ * @param word  word to find
+ * @return      true if the word was found
+ */
+static inline bool contains_word(const std::string& str, const std::string& word)
+{
+    split_ws_tokenizer tokenizer(str.data(), str.data() + str.size());
+    string_ref token;
+
+    while (tokenizer.next(token))
+    {
+        if (token == word) return true;
+    }
+
+    return false;
+}
+
+/**
+ * Hash set of words matched against the whitespace-delimited words of a
+ * string in one pass, however large the set. It works
+ * like calling contains_word() for each word of the set, but the string is
+ * tokenized only once with the rules of split_ws(), and each token is looked
+ * up in an open-addressing hash table. The table stores a hash tag next to
+ * each word index, and a bit mask of the word lengths present skips tokens
+ * of other lengths without hashing. With fold_case the ASCII letters match
+ * case-insensitively. A matcher built once can be shared read-only, e.g. by
+ * worker threads checking different documents.
+ *
+ * Words are numbered in the order given. Empty words never match, and a word
+ * equal to an earlier one is reported as the earlier one.
+ */
+class word_matcher
+{
+public:
+    /**
+     * Compile a list of words.
+     *
+     * @param words         words to match
+     * @param fold_case     match words case-insensitively
+     */
+    explicit word_matcher(const std::vector<std::string>& words, bool fold_case = false)
+        : m_fold_case(fold_case)
+    {
+        compile(words.begin(), words.end());
+    }
+
+    /**
+     * Compile a range of words, see above.
+     *
+     * @param begin         iterator to the first word
+     * @param end           iterator beyond the last word
+     * @param fold_case     match words case-insensitively
+     */
+    template <typename Iterator>
+    word_matcher(Iterator begin, Iterator end, bool fold_case = false)
+        : m_fold_case(fold_case)
+    {
+        compile(begin, end);
+    }
+
+    //! number of words compiled
+    size_t size() const { return m_offset.size() - 1; }
+
+    //! whether ASCII letters match case-insensitively
+    bool fold_case() const { return m_fold_case; }
+
+    //! return the i-th word
+    string_ref word(size_t i) const
+    {
+        return string_ref(m_chars.data() + m_offset[i], m_offset[i + 1] - m_offset[i]);
+    }
+
+    /**
+     * Look up a single token in the word set.
+     *
+     * @param token         token to look up
+     * @return              index of the matching word, or npos
+     */
+    size_t lookup(const string_ref& token) const
+    {
+        size_t n = token.size();
+        if ((m_lengths & length_bit(n)) == 0)
+            return std::string::npos;
+
+        unsigned long long h = hash_icase(token.data(), n);
+        unsigned int tag = static_cast<unsigned int>(h >> 32);
+
+        for (size_t i = static_cast<size_t>(h) & m_mask; ; i = (i + 1) & m_mask)
+        {
+            const slot& s = m_slot[i];
+            if (s.word == empty_slot) return std::string::npos;
+
+            if (s.tag == tag && m_offset[s.word + 1] - m_offset[s.word] == n &&
+                (m_fold_case
+                 ? memcmp_icase(m_chars.data() + m_offset[s.word], token.data(), n) == 0
+                 : memcmp(m_chars.data() + m_offset[s.word], token.data(), n) == 0))
+                return s.word;
+        }
+    }
+
+    //! check whether a single token is in the word set
+    bool contains(const string_ref& token) const
+    {
+        return lookup(token) != std::string::npos;
+    }
+
+    /**
+     * Find the first whitespace-delimited word of str which is in the set.
+     *
+     * @param str           whitespace-delimited string to check
+     * @return              the matching word within str, or an empty string_ref
+     */
+    string_ref find_first(const string_ref& str) const
+    {
+        split_ws_tokenizer tokenizer(str.begin(), str.end());
+        string_ref token;
+
+        while (tokenizer.next(token))
+        {
+            if (contains(token)) return token;
+        }
+
+        return string_ref();
+    }
+
+    /**
+     * Find all whitespace-delimited words of str which are in the set.
+     *
+     * @param str           whitespace-delimited string to check
+     * @return              the matching words within str, in order
+     */
+    std::vector<string_ref> find_all(const string_ref& str) const
+    {
+        std::vector<string_ref> out;
+        split_ws_tokenizer tokenizer(str.begin(), str.end());
+        string_ref token;
+
+        while (tokenizer.next(token))
+        {
+            if (contains(token)) out.push_back(token);
+        }
+
+        return out;
+    }
+
+    /**
+     * Count the occurrences of each word of the set among the
+     * whitespace-delimited words of str.
+     *
+     * @param str           whitespace-delimited string to check
+     * @return              vector of counts indexed by word
+     */
+    std::vector<size_t> count(const string_ref& str) const
+    {
+        std::vector<size_t> counts(size(), 0);
+        split_ws_tokenizer tokenizer(str.begin(), str.end());
+        string_ref token;
+
+        while (tokenizer.next(token))
+        {
+            size_t i = lookup(token);
+            if (i != std::string::npos) ++counts[i];
+        }
+
+        return counts;
+    }
+
+private:
+    //! word index marking an unused hash table slot
+    static const unsigned int empty_slot = UINT_MAX;
+
+    //! hash table slot: the upper hash bits as tag and the word index
+    struct slot
+    {
+        unsigned int tag, word;
+    };
+
+    //! whether ASCII letters match case-insensitively
+    bool m_fold_case;
+
+    //! concatenated characters of the words
+    std::string m_chars;
+
+    //! start offsets of the words in m_chars, followed by the total size
+    std::vector<size_t> m_offset;
+
+    //! bit mask of the word lengths in the table, see length_bit()
+    unsigned long long m_lengths;
+
+    //! open-addressing hash table with linear probing
+    std::vector<slot> m_slot;
+
+    //! hash table size minus one, the size is a power of two
+    size_t m_mask;
+
+    //! bit of a word length in m_lengths, lengths >= 63 share the top bit
+    static unsigned long long length_bit(size_t n)
+    {
+        return 1ull << (n < 63 ? n : 63);
+    }
+
+    //! store the words and build the hash table at most half full
+    template <typename Iterator>
+    void compile(Iterator begin, Iterator end)
+    {
+        m_offset.assign(1, 0);
+        for (; begin != end; ++begin)
+        {
+            string_ref w(*begin);
+            m_chars.append(w.data(), w.size());
+            m_offset.push_back(m_chars.size());
+        }
+
+        if (size() >= empty_slot)
+            throw(std::runtime_error("word_matcher: too many words"));
+
+        size_t cap = 2;
+        while (cap < 2 * size()) cap *= 2;
+
+        slot empty = { 0, empty_slot };
+        m_slot.assign(cap, empty);
+        m_mask = cap - 1;
+        m_lengths = 0;
+
+        for (size_t w = 0; w < size(); ++w)
+        {
+            string_ref token = word(w);
+            if (token.empty() || contains(token)) continue;
+
+            unsigned long long h = hash_icase(token.data(), token.size());
+            size_t i = static_cast<size_t>(h) & m_mask;
+            while (m_slot[i].word != empty_slot) i = (i + 1) & m_mask;
+
+            m_slot[i].tag = static_cast<unsigned int>(h >> 32);
+            m_slot[i].word = static_cast<unsigned int>(w);
+            m_lengths |= length_bit(token.size());
+        }
+    }
+};
+
+/**
+ * Search the string for given start and end separators and extract all
+ * characters between the both, if they are found. Otherwise return an empty
+ * string.
+ *
+ * @param str   string to search in
+ * @param sep1  start boundary
+ * @param sep2  end boundary
+ */
+static inline std::string extract_between(const std::string& str,
+                                          const std::string& sep1,
+                                          const std::string& sep2)
+{
+    std::string::size_type start = str.find(sep1);
+    if (start == std::string::npos)
+        return std::string();
+
+    start += sep1.length();
+
+    std::string::size_type limit = str.find(sep2, start);
+
+    if (limit == std::string::npos)
+        return std::string();
+
+    return str.substr(start, limit - start);
+}
+
+/**
+ * Search the string for given compiled start and end separators and extract
+ * all characters between the both, if they are found. Otherwise return an
+ * empty string. Each separator matches case-insensitively if it was compiled
+ * with fold_case.
+ *
+ * @param str   string to search in
+ * @param sep1  start boundary
+ * @param sep2  end boundary
+ */
+static inline std::string extract_between(const std::string& str,
+                                          const searcher& sep1,
+                                          const searcher& sep2)
+{
+    std::string::size_type start = sep1.find(str);
+    if (start == std::string::npos)
+        return std::string();
+
+    start += sep1.size();
+
+    std::string::size_type limit = sep2.find(str, start);
+
+    if (limit == std::string::npos)
+        return std::string();
+
+    return str.substr(start, limit - start);
+}
+
+/**
+ * Search the string for given start and end separators and extract all
+ * characters between the both, if they are found. Otherwise return an empty
+ * string. Ignore case while searching.
+ *
+ * @param str   string to search in
+ * @param sep1  start boundary
+ * @param sep2  end boundary
+ */
+static inline std::string extract_between_icase(const std::string& str,
+                                                const std::string& sep1,
+                                                const std::string& sep2)
+{
+    std::string::size_type start = find_icase(str, sep1);
+    if (start == std::string::npos)
+        return std::string();
+
+    start += sep1.length();
+
+    std::string::size_type limit = find_icase(str, sep2, start);
+
+    if (limit == std::string::npos)
+        return std::string();
+
+    return str.substr(start, limit - start);
+}
+
+
+// ***                                ***
+// *** String Concatenation Functions ***
+// ***                                ***
+
+/**
+ * One piece of a concatenation: a reference to a std::string, string_ref or C
+ * string, a single character, or an integer which is formatted in decimal
+ * into a small internal buffer. The referenced strings must outlive the
+ * piece.
+ */
+class concat_piece
+{
+public:
+    concat_piece(const std::string& str)
+        : m_data(str.data()), m_size(str.size())
+    { }
+
+    concat_piece(const string_ref& str)
+        : m_data(str.data()), m_size(str.size())
+    { }
+
+    concat_piece(const char* str)
+        : m_data(str), m_size(strlen(str))
+    { }
+
+    concat_piece(char c)
+        : m_data(NULL), m_size(1)
+    {
+        m_buffer[sizeof(m_buffer) - 1] = c;
+    }
+
+    concat_piece(int v) { format_signed(v); }
+    concat_piece(long v) { format_signed(v); }
+    concat_piece(unsigned int v) { format_unsigned(v); }
+    concat_piece(unsigned long v) { format_unsigned(v); }
+    concat_piece(long long v) { format_signed(v); }
+    concat_piece(unsigned long long v) { format_unsigned(v); }
+
+    //! copy constructor: copy the internal buffer only if it is used
+    concat_piece(const concat_piece& other)
+        : m_data(other.m_data), m_size(other.m_size)
+    {
+        if (!m_data)
+            memcpy(m_buffer + sizeof(m_buffer) - m_size,
+                   other.m_buffer + sizeof(m_buffer) - m_size, m_size);
+    }
+
+    //! number of characters of the piece
+    std::string::size_type size() const { return m_size; }
+
+    //! pointer to the characters of the piece
+    const char* data() const
+    { return m_data ? m_data : m_buffer + sizeof(m_buffer) - m_size; }
+
+    //! append the piece to the output string
+    void append(std::string& out) const
+    { out.append(data(), m_size); }
+
+private:
+    //! pointer to referenced characters, or NULL if in m_buffer
+    const char* m_data;
+
+    //! number of characters
+    std::string::size_type m_size;
+
+    //! right-aligned formatted integer or single character
+    char m_buffer[24];
+
+    //! format an unsigned integer into the end of m_buffer
+    template <typename Unsigned>
+    void format_unsigned(Unsigned v)
+    {
+        char* p = m_buffer + sizeof(m_buffer);
+        do {
+            *--p = static_cast<char>('0' + (v % 10));
+            v /= 10;
+        } while (v != 0);
+
+        m_data = NULL;
+        m_size = static_cast<std::string::size_type>(m_buffer + sizeof(m_buffer) - p);
+    }
+
+    //! format a signed integer into the end of m_buffer
+    template <typename Signed>
+    void format_signed(Signed v)
+    {
+        // negate in the unsigned domain to handle the smallest value
+        unsigned long long u = static_cast<unsigned long long>(v);
+        if (v < 0) u = 0 - u;
+
+        format_unsigned(u);
+        if (v < 0) {
+            m_buffer[sizeof(m_buffer) - 1 - m_size] = '-';
+            ++m_size;
+        }
+    }
+
+    //! non-assignable
+    concat_piece& operator = (const concat_piece&);
+};
+
+/** Empty start of a concatenation expression. */
+struct concat_nil
+{
+    std::string::size_type size() const { return 0; }
+
+    void append(std::string&) const { }
+};
+
+/**
+ * Lazy concatenation expression created by concat(a) + b + c. Nothing is
+ * copied until the expression is converted to a std::string or appended using
+ * append_to(). Then the total length is calculated first, and the result is
+ * built with exactly one allocation. The expression references its string
+ * pieces, hence it should not be stored beyond the full-expression creating
+ * it.
+ */
+template <typename Left>
+class concat_expr
+{
+public:
+    concat_expr(const Left& left, const concat_piece& right)
+        : m_left(left), m_right(right)
+    { }
+
+    //! total number of characters of the concatenation
+    std::string::size_type size() const
+    { return m_left.size() + m_right.size(); }
+
+    //! append all pieces to the output string, without reserving space
+    void append(std::string& out) const
+    {
+        m_left.append(out);
+        m_right.append(out);
+    }
+
+    //! materialize the concatenation with one allocation
+    std::string str() const
+    {
+        std::string out;
+        out.reserve(size());
+        append(out);
+        return out;
+    }
+
+    //! materialize the concatenation with one allocation
+    operator std::string () const
+    {
+        return str();
+    }
+
+private:
+    //! preceding pieces
+    Left m_left;
+
+    //! last piece
+    concat_piece m_right;
+};
+
+/**
+ * Start a lazy concatenation expression, which is continued using operator+
+ * with strings, string_refs, characters and integers:
+ * std::string s = concat("id=") + id + ", name=" + name;
+ */
+static inline concat_expr<concat_nil> concat(const concat_piece& first)
+{
+    return concat_expr<concat_nil>(concat_nil(), first);
+}
+
+/** Append another piece to a lazy concatenation expression. */
+template <typename Left>
+static inline concat_expr<concat_expr<Left> >
+operator + (const concat_expr<Left>& left, const concat_piece& right)
+{
+    return concat_expr<concat_expr<Left> >(left, right);
+}
+
+/**
+ * Append a lazy concatenation expression to a caller-owned string. The string
+ * is grown at most once.
+ *
+ * @param out   string to append to
+ * @param expr  concatenation expression
+ * @return      reference to out
+ */
+template <typename Left>
+static inline std::string& append_to(std::string& out, const concat_expr<Left>& expr)
+{
+    out.reserve(out.size() + expr.size());
+    expr.append(out);
+    return out;
+}
+
+// ***                   ***
+// *** Flat String Table ***
+// ***                   ***
+
+/**
+ * Append-only table of strings stored as one contiguous character arena plus
+ * an array of offsets. It can be filled by the split functions and passed to
+ * join(). Unlike a std::vector<std::string>, appending a string does not
+ * allocate memory of its own, and clear() keeps the capacity of both arrays,
+ * hence a table reused for each batch of input reaches a steady state without
+ * any allocations.
+ *
+ * The entries are returned as string_ref objects, which are invalidated when
+ * the table grows or is cleared.
+ */
+class string_table
+{
+public:
+    typedef string_ref value_type;
+    typedef std::string::size_type size_type;
+
+    /**
+     * Random access iterator over the entries. Dereferencing returns a
+     * string_ref by value.
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef string_ref value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const string_ref* pointer;
+        typedef string_ref reference;
+
+        const_iterator()
+            : m_table(NULL), m_index(0)
+        { }
+
+        const_iterator(const string_table* table, size_type index)
+            : m_table(table), m_index(index)
+        { }
+
+        string_ref operator * () const { return (*m_table)[m_index]; }
+
+        string_ref operator [] (difference_type n) const
+        { return (*m_table)[m_index + n]; }
+
+        const_iterator& operator ++ () { ++m_index; return *this; }
+        const_iterator& operator -- () { --m_index; return *this; }
+
+        const_iterator operator ++ (int)
+        { const_iterator tmp = *this; ++m_index; return tmp; }
+
+        const_iterator operator -- (int)
+        { const_iterator tmp = *this; --m_index; return tmp; }
+
+        const_iterator& operator += (difference_type n)
+        { m_index += n; return *this; }
+
+        const_iterator& operator -= (difference_type n)
+        { m_index -= n; return *this; }
+
+        const_iterator operator + (difference_type n) const
+        { return const_iterator(m_table, m_index + n); }
+
+        const_iterator operator - (difference_type n) const
+        { return const_iterator(m_table, m_index - n); }
+
+        difference_type operator - (const const_iterator& other) const
+        { return static_cast<difference_type>(m_index - other.m_index); }
+
+        bool operator == (const const_iterator& other) const
+        { return m_index == other.m_index; }
+
+        bool operator != (const const_iterator& other) const
+        { return m_index != other.m_index; }
+
+        bool operator < (const const_iterator& other) const
+        { return m_index < other.m_index; }
+
+        bool operator > (const const_iterator& other) const
+        { return m_index > other.m_index; }
+
+        bool operator <= (const const_iterator& other) const
+        { return m_index <= other.m_index; }
+
+        bool operator >= (const const_iterator& other) const
+        { return m_index >= other.m_index; }
+
+        friend const_iterator operator + (difference_type n, const const_iterator& it)
+        { return it + n; }
+
+    private:
+        //! table iterated over
+        const string_table* m_table;
+
+        //! index of current entry
+        size_type m_index;
+    };
+
+    typedef const_iterator iterator;
+
+    //! construct an empty table
+    string_table()
+        : m_offsets(1, 0)
+    { }
+
+    //! number of strings in the table
+    size_type size() const { return m_offsets.size() - 1; }
+
+    //! true if the table contains no strings
+    bool empty() const { return (m_offsets.size() == 1); }
+
+    //! total number of characters of all strings
+    size_type chars() const { return m_arena.size(); }
+
+    //! return a reference to the i-th string
+    string_ref operator [] (size_type i) const
+    {
+        return string_ref(m_arena.data() + m_offsets[i],
+                          m_offsets[i + 1] - m_offsets[i]);
+    }
+
+    //! iterator to the first string
+    const_iterator begin() const { return const_iterator(this, 0); }
+
+    //! past-the-end iterator
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    //! append a copy of the given characters as new string
+    void push_back(const string_ref& str)
+    {
+        m_arena.append(str.data(), str.size());
+        m_offsets.push_back(m_arena.size());
+    }
+
+    //! reserve space for the given number of strings and characters
+    void reserve(size_type strings, size_type chars)
+    {
+        m_offsets.reserve(strings + 1);
+        m_arena.reserve(chars);
+    }
+
+    //! remove all strings but keep the allocated memory for reuse
+    void clear()
+    {
+        m_arena.clear();
+        m_offsets.resize(1);
+    }
+
+    //! swap contents with another table
+    void swap(string_table& other)
+    {
+        m_arena.swap(other.m_arena);
+        m_offsets.swap(other.m_offsets);
+    }
+
+private:
+    //! characters of all strings, concatenated
+    std::string m_arena;
+
+    //! offsets of the strings in the arena, with a trailing sentinel
+    std::vector<size_type> m_offsets;
+};
+
+// ***                          ***
+// *** Split and Join Functions ***
+// ***                          ***
+
+// *** Algorithms and Helper Functions ***
+
+/**
+ * Append all parts delivered by the tokenizer to the output container. Each
+ * part is appended as Container::value_type(first, last), hence any container
+ * of std::string or string_ref can be filled.
+ *
+ * @param out           container to append the split parts to
+ * @param tokenizer     tokenizer delivering the parts
+ */
+template <typename Container, typename Tokenizer>
+static inline void split_tokens(Container& out, Tokenizer tokenizer)
+{
+    typedef typename Container::value_type value_type;
+
+    string_ref token;
+    while (tokenizer.next(token))
+        out.push_back(value_type(token.begin(), token.end()));
+}
+
+/**
+ * Split the character range [begin,end) by whitespaces and append each word to
+ * the output container. Multiple consecutive whitespaces are considered as one
+ * split point.
+ *
+ * @param out   container to append the split parts to
+ * @param begin start of the character range to split
+ * @param end   end of the character range to split
+ * @param limit maximum number of parts appended
+ */
+template <typename Container>
+static inline void split_ws_algorithm(Container& out, const char* begin, const char* end, std::string::size_type limit)
+{
+    split_tokens(out, split_ws_tokenizer(begin, end, limit));
+}
+
+/**
+ * Split the character range [begin,end) at each separator character and
+ * append each part to the output container. Multiple consecutive separators
+ * are considered individually and will result in empty split substrings.
+ *
+ * @param out   container to append the split parts to
+ * @param begin start of the character range to split
+ * @param end   end of the character range to split
+ * @param sep   separator character
+ * @param limit maximum number of parts appended
+ */
+template <typename Container>
+static inline void split_algorithm(Container& out, const char* begin, const char* end, char sep, std::string::size_type limit)
+{
+    split_tokens(out, split_tokenizer(begin, end, sep, limit));
+}
+
+/**
+ * Split the character range [begin,end) at each separator string and append
+ * each part to the output container. Multiple consecutive separators are
+ * considered individually and will result in empty split substrings.
+ *
+ * @param out           container to append the split parts to
+ * @param begin         start of the character range to split
+ * @param end           end of the character range to split
+ * @param sep           start of the separator string
+ * @param seplen        length of the separator string
+ * @param limit         maximum number of parts appended
+ */
+template <typename Container>
+static inline void split_algorithm(Container& out, const char* begin, const char* end, const char* sep, std::string::size_type seplen, std::string::size_type limit)
+{
+    split_tokens(out, split_str_tokenizer(begin, end, sep, seplen, limit));
+}
+
+/**
+ * Split the character range [begin,end) at each character contained in the
+ * set and append each part to the output container. If collapse is true,
+ * multiple consecutive separators are considered as one split point,
+ * otherwise they result in empty split substrings.
+ *
+ * @param out           container to append the split parts to
+ * @param begin         start of the character range to split
+ * @param end           end of the character range to split
+ * @param set           set of separator characters
+ * @param collapse      skip empty split substrings
+ * @param limit         maximum number of parts appended
+ */
+template <typename Container>
+static inline void split_any_algorithm(Container& out, const char* begin, const char* end, const char_set& set, bool collapse, std::string::size_type limit)
+{
+    split_tokens(out, split_set_tokenizer(begin, end, set, collapse, limit));
+}
+
+/**
+ * Split the character range [begin,end) at each separator character outside
+ * of double-quoted regions, as in RFC 4180 CSV or TSV records, and append
+ * each raw field including its quotes to the output container. Every quote
+ * toggles the quoting state, hence an escaped quote "" inside a quoted field
+ * keeps it quoted. Unlike split(), a trailing separator results in a final
+ * empty field. The range is classified in blocks of 64 bytes by the
+ * csv_block scanning kernel.
+ *
+ * @param out   container to append the fields to
+ * @param begin start of the character range to split
+ * @param end   end of the character range to split
+ * @param sep   separator character
+ * @param limit maximum number of fields appended
+ */
+template <typename Container>
+static inline void split_csv_algorithm(Container& out, const char* begin, const char* end, char sep, std::string::size_type limit)
+{
+    typedef typename Container::value_type value_type;
+
+    if (limit == 0 || begin == end) return;
+
+    unsigned long long (*csv_block)(const char*, char, unsigned long long&) =
+        scan_dispatch().csv_block;
+    unsigned long long quoted = 0;
+    const char* field = begin;
+
+    for (const char* p = begin; p < end && limit > 1; p += 64)
+    {
+        unsigned long long seps;
+
+        if (end - p >= 64) {
+            seps = csv_block(p, sep, quoted);
+        }
+        else {
+            // classify the tail in a padded copy and mask out the padding
+            char block[64];
+            memset(block, 0, sizeof(block));
+            memcpy(block, p, static_cast<size_t>(end - p));
+            seps = csv_block(block, sep, quoted) &
+                ((static_cast<unsigned long long>(1) << (end - p)) - 1);
+        }
+
+        for (; seps != 0 && limit > 1; seps &= seps - 1, --limit) {
+            const char* it = p + scan_ctz64(seps);
+            out.push_back(value_type(field, it));
+            field = it + 1;
+        }
+    }
+
+    out.push_back(value_type(field, end));
+}
+
+// *** std::vector<std::string> Split Functions ***
+
+/**
+ * Split the given string by whitespaces into distinct words. Multiple
+ * consecutive whitespaces are considered as one split point. Whitespaces are
+ * space, tab, newline and carriage-return.
+ *
+ * @param str   string to split
+ * @param limit maximum number of parts returned
+ * @return      vector containing each split substring
+ */
+static inline std::vector<std::string> split_ws(const std::string& str, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_ws_algorithm(out, str.data(), str.data() + str.size(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator character into distinct
+ * substrings. Multiple consecutive separators are considered individually and
+ * will result in empty split substrings.
+ *
+ * @param str   string to split
+ * @param sep   separator character
+ * @param limit maximum number of parts returned
+ * @return      vector containing each split substring
+ */
+static inline std::vector<std::string> split(const std::string& str, char sep, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_algorithm(out, str.data(), str.data() + str.size(), sep, limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator string into distinct
+ * substrings. Multiple consecutive separators are considered individually and
+ * will result in empty split substrings.
+ *
+ * @param str           string to split
+ * @param sepstr        separator string
+ * @param limit         maximum number of parts returned
+ * @return              vector containing each split substring
+ */
+static inline std::vector<std::string> split(const std::string& str, const std::string& sepstr, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_algorithm(out, str.data(), str.data() + str.size(),
+                    sepstr.data(), sepstr.size(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each occurrence of a compiled separator into
+ * distinct substrings, see split() above. The separator matches
+ * case-insensitively if it was compiled with fold_case.
+ *
+ * @param str           string to split
+ * @param sep           compiled separator
+ * @param limit         maximum number of parts returned
+ * @return              vector containing each split substring
+ */
+static inline std::vector<std::string> split(const std::string& str, const searcher& sep, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_tokens(out, split_searcher_tokenizer(str.data(), str.data() + str.size(),
+                                               sep, limit));
+    return out;
+}
+
+/**
+ * Split the given string at each character contained in the set into distinct
+ * substrings. Multiple consecutive separators are considered individually and
+ * will result in empty split substrings, like in split(). The set can be given
+ * as a string of characters, e.g. ",;|\t", or as a precompiled char_set.
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      vector containing each split substring
+ */
+static inline std::vector<std::string> split_any(const std::string& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_any_algorithm(out, str.data(), str.data() + str.size(), set, false, limit);
+    return out;
+}
+
+/**
+ * Split the given string at each character contained in the set into distinct
+ * substrings. Multiple consecutive separators are considered as one split
+ * point, like in split_ws().
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      vector containing each split substring
+ */
+static inline std::vector<std::string> split_any_collapse(const std::string& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    std::vector<std::string> out;
+    split_any_algorithm(out, str.data(), str.data() + str.size(), set, true, limit);
+    return out;
+}
+
+// *** Zero-Copy std::vector<string_ref> Split Functions ***
+
+/**
+ * Split the given string by whitespaces into distinct words, exactly like
+ * split_ws(), but return references into the original string instead of
+ * copies. The referenced string must outlive the returned vector.
+ *
+ * @param str   string to split
+ * @param limit maximum number of parts returned
+ * @return      vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_ws_view(const string_ref& str, std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_ws_algorithm(out, str.begin(), str.end(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator character, exactly like split(),
+ * but return references into the original string instead of copies. The
+ * referenced string must outlive the returned vector.
+ *
+ * @param str   string to split
+ * @param sep   separator character
+ * @param limit maximum number of parts returned
+ * @return      vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_view(const string_ref& str, char sep, std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_algorithm(out, str.begin(), str.end(), sep, limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator string, exactly like split(), but
+ * return references into the original string instead of copies. The
+ * referenced string must outlive the returned vector.
+ *
+ * @param str           string to split
+ * @param sepstr        separator string
+ * @param limit         maximum number of parts returned
+ * @return              vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_view(const string_ref& str, const string_ref& sepstr, std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_algorithm(out, str.begin(), str.end(),
+                    sepstr.data(), sepstr.size(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each character contained in the set, exactly like
+ * split_any(), but return references into the original string instead of
+ * copies. The referenced string must outlive the returned vector.
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_any_view(const string_ref& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_any_algorithm(out, str.begin(), str.end(), set, false, limit);
+    return out;
+}
+
+/**
+ * Split the given string at each character contained in the set, exactly like
+ * split_any_collapse(), but return references into the original string
+ * instead of copies. The referenced string must outlive the returned vector.
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_any_collapse_view(const string_ref& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_any_algorithm(out, str.begin(), str.end(), set, true, limit);
+    return out;
+}
+
+// *** string_table Split Functions ***
+
+/**
+ * Split the given string by whitespaces like split_ws() and append the words
+ * to the string table. The string must not reference the table itself.
+ *
+ * @param out   string table to append the words to
+ * @param str   string to split
+ * @param limit maximum number of parts appended
+ * @return      reference to out
+ */
+static inline string_table& split_ws(string_table& out, const string_ref& str, std::string::size_type limit = std::string::npos)
+{
+    split_ws_algorithm(out, str.begin(), str.end(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator character like split() and append
+ * the parts to the string table. The string must not reference the table
+ * itself.
+ *
+ * @param out   string table to append the parts to
+ * @param str   string to split
+ * @param sep   separator character
+ * @param limit maximum number of parts appended
+ * @return      reference to out
+ */
+static inline string_table& split(string_table& out, const string_ref& str, char sep, std::string::size_type limit = std::string::npos)
+{
+    split_algorithm(out, str.begin(), str.end(), sep, limit);
+    return out;
+}
+
+/**
+ * Split the given string at each separator string like split() and append the
+ * parts to the string table. The string must not reference the table itself.
+ *
+ * @param out           string table to append the parts to
+ * @param str           string to split
+ * @param sepstr        separator string
+ * @param limit         maximum number of parts appended
+ * @return              reference to out
+ */
+static inline string_table& split(string_table& out, const string_ref& str, const string_ref& sepstr, std::string::size_type limit = std::string::npos)
+{
+    split_algorithm(out, str.begin(), str.end(),
+                    sepstr.data(), sepstr.size(), limit);
+    return out;
+}
+
+/**
+ * Split the given string at each character contained in the set like
+ * split_any() and append the parts to the string table. The string must not
+ * reference the table itself.
+ *
+ * @param out   string table to append the parts to
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts appended
+ * @return      reference to out
+ */
+static inline string_table& split_any(string_table& out, const string_ref& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    split_any_algorithm(out, str.begin(), str.end(), set, false, limit);
+    return out;
+}
+
+// *** Quote-Aware CSV Split Functions ***
+
+/**
+ * Split a CSV record at each separator character outside of double-quoted
+ * fields, as specified by RFC 4180, and return references to the raw fields
+ * in the original string. Quoted fields keep their quotes and escaped "" and
+ * may contain separators and newlines; call csv_unescape() on the fields
+ * which are needed as values. A trailing separator results in a final empty
+ * field, while an empty record has no fields. Use sep = '\t' for TSV.
+ *
+ * @param str   CSV record to split
+ * @param sep   separator character
+ * @param limit maximum number of fields returned
+ * @return      vector containing a reference to each raw field
+ */
+static inline std::vector<string_ref> split_csv_view(const string_ref& str, char sep = ',', std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> out;
+    split_csv_algorithm(out, str.begin(), str.end(), sep, limit);
+    return out;
+}
+
+/**
+ * Unescape a raw CSV field as returned by split_csv_view(): if the field
+ * starts with a double quote, the enclosing quotes are removed and each
+ * escaped "" is replaced by a single quote. Unquoted fields are returned
+ * unchanged.
+ *
+ * @param field raw CSV field
+ * @return      value of the field
+ */
+static inline std::string csv_unescape(const string_ref& field)
+{
+    if (field.empty() || field[0] != '"')
+        return field.str();
+
+    std::string out;
+    out.reserve(field.size());
+
+    bool quoted = true;
+    for (const char* p = field.begin() + 1; p != field.end(); ++p)
+    {
+        if (*p != '"')
+            out += *p;
+        else if (quoted && p + 1 != field.end() && p[1] == '"')
+            out += *p++;
+        else
+            quoted = !quoted;
+    }
+
+    return out;
+}
+
+/**
+ * Split a CSV record at each separator character outside of double-quoted
+ * fields like split_csv_view() and return the unescaped values of the fields.
+ *
+ * @param str   CSV record to split
+ * @param sep   separator character
+ * @param limit maximum number of fields returned
+ * @return      vector containing the value of each field
+ */
+static inline std::vector<std::string> split_csv(const string_ref& str, char sep = ',', std::string::size_type limit = std::string::npos)
+{
+    std::vector<string_ref> fields;
+    split_csv_algorithm(fields, str.begin(), str.end(), sep, limit);
+
+    std::vector<std::string> out;
+    out.reserve(fields.size());
+    for (std::vector<string_ref>::const_iterator it = fields.begin();
+         it != fields.end(); ++it)
+        out.push_back(csv_unescape(*it));
+
+    return out;
+}
+
+// *** Lazy Split Ranges ***
+
+/**
+ * Return a lazy range over the whitespace-delimited words of the string, with
+ * the same parts as split_ws(). Each word is searched for only when the
+ * iterator is advanced, hence no vector is built. The string must outlive the
+ * range.
+ *
+ * @param str   string to split
+ * @param limit maximum number of parts returned
+ * @return      forward range of string_ref parts
+ */
+static inline token_range<split_ws_tokenizer> split_ws_range(const string_ref& str, std::string::size_type limit = std::string::npos)
+{
+    return token_range<split_ws_tokenizer>(
+        split_ws_tokenizer(str.begin(), str.end(), limit));
+}
+
+/**
+ * Return a lazy range over the parts of the string split at each separator
+ * character, with the same parts as split(). Each part is searched for only
+ * when the iterator is advanced, hence no vector is built. The string must
+ * outlive the range.
+ *
+ * @param str   string to split
+ * @param sep   separator character
+ * @param limit maximum number of parts returned
+ * @return      forward range of string_ref parts
+ */
+static inline token_range<split_tokenizer> split_range(const string_ref& str, char sep, std::string::size_type limit = std::string::npos)
+{
+    return token_range<split_tokenizer>(
+        split_tokenizer(str.begin(), str.end(), sep, limit));
+}
+
+/**
+ * Return a lazy range over the parts of the string split at each separator
+ * string, with the same parts as split(). Each part is searched for only when
+ * the iterator is advanced, hence no vector is built. The string and the
+ * separator must outlive the range.
+ *
+ * @param str           string to split
+ * @param sepstr        separator string
+ * @param limit         maximum number of parts returned
+ * @return              forward range of string_ref parts
+ */
+static inline token_range<split_str_tokenizer> split_range(const string_ref& str, const string_ref& sepstr, std::string::size_type limit = std::string::npos)
+{
+    return token_range<split_str_tokenizer>(
+        split_str_tokenizer(str.begin(), str.end(),
+                            sepstr.data(), sepstr.size(), limit));
+}
+
+/**
+ * Return a lazy range over the parts of the string split at each character
+ * contained in the set, with the same parts as split_any(). The string must
+ * outlive the range.
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      forward range of string_ref parts
+ */
+static inline token_range<split_set_tokenizer> split_any_range(const string_ref& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    return token_range<split_set_tokenizer>(
+        split_set_tokenizer(str.begin(), str.end(), set, false, limit));
+}
+
+/**
+ * Return a lazy range over the parts of the string split at each character
+ * contained in the set, with the same parts as split_any_collapse(). The
+ * string must outlive the range.
+ *
+ * @param str   string to split
+ * @param set   set of separator characters
+ * @param limit maximum number of parts returned
+ * @return      forward range of string_ref parts
+ */
+static inline token_range<split_set_tokenizer> split_any_collapse_range(const string_ref& str, const char_set& set, std::string::size_type limit = std::string::npos)
+{
+    return token_range<split_set_tokenizer>(
+        split_set_tokenizer(str.begin(), str.end(), set, true, limit));
+}
+
+#if STX_STRING_THREADS
+
+// *** Parallel Split Functions ***
+
+/*
+ * The parallel split functions cut the input into one chunk per thread. Each
+ * cut is moved forward to the next split point, such that no part straddles
+ * two chunks, and the chunks are tokenized concurrently into string_ref
+ * parts. The limit is applied while stitching the parts together in their
+ * original order, and finally the output values are constructed concurrently.
+ */
+
+/*
+ * Minimum number of bytes per thread if the parallel split functions choose
+ * the number of threads themselves.
+ */
+static const std::string::size_type split_parallel_min_chunk = 256 * 1024;
+
+/** Parallel split policy for split() at a separator character. */
+struct split_parallel_char
+{
+    //! separator character
+    char sep;
+
+    explicit split_parallel_char(char s) : sep(s) { }
+
+    //! return the first chunk boundary at or after p: just after a separator
+    const char* cut(const char* p, const char* end) const
+    {
+        p = find_char(p, end, sep);
+        return (p == end) ? end : p + 1;
+    }
+
+    //! return a tokenizer over the chunk [begin,end)
+    split_tokenizer tokenizer(const char* begin, const char* end,
+                              std::string::size_type limit = std::string::npos) const
+    {
+        return split_tokenizer(begin, end, sep, limit);
+    }
+};
+
+/** Parallel split policy for split_ws() at whitespace. */
+struct split_parallel_ws
+{
+    //! return the first chunk boundary at or after p: at a whitespace
+    const char* cut(const char* p, const char* end) const
+    {
+        return find_split_ws(p, end);
+    }
+
+    //! return a tokenizer over the chunk [begin,end)
+    split_ws_tokenizer tokenizer(const char* begin, const char* end,
+                                 std::string::size_type limit = std::string::npos) const
+    {
+        return split_ws_tokenizer(begin, end, limit);
+    }
+};
+
+/**
+ * Run func(i) for i = 0..n-1 concurrently, func(0) on the calling thread, and
+ * rethrow the first exception thrown by any of them after all have finished.
+ */
+template <typename Function>
+static inline void split_parallel_run(unsigned int n, const Function& func)
+{
+    std::vector<std::exception_ptr> errors(n);
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+
+    try {
+        for (unsigned int i = 1; i < n; ++i) {
+            threads.emplace_back([&func, &errors, i]() {
+                try { func(i); }
+                catch (...) { errors[i] = std::current_exception(); }
+            });
+        }
+        func(0);
+    }
+    catch (...) {
+        errors[0] = std::current_exception();
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    for (size_t i = 0; i < n; ++i) {
+        if (errors[i]) std::rethrow_exception(errors[i]);
+    }
+}
+
+/**
+ * Split the character range [begin,end) concurrently using the given policy
+ * and append the parts to the output vector, exactly as the policy's
+ * tokenizer would sequentially.
+ *
+ * @param out           vector to append the split parts to
+ * @param begin         start of the character range to split
+ * @param end           end of the character range to split
+ * @param policy        split point policy
+ * @param limit         maximum number of parts appended
+ * @param threads       number of threads, or zero for one per core
+ */
+template <typename Value, typename Policy>
+static inline void split_parallel_algorithm(std::vector<Value>& out, const char* begin, const char* end, const Policy& policy, std::string::size_type limit, unsigned int threads)
+{
+    std::string::size_type size = static_cast<std::string::size_type>(end - begin);
+
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+        threads = static_cast<unsigned int>(
+            std::min<std::string::size_type>(threads, size / split_parallel_min_chunk + 1));
+    }
+
+    if (threads <= 1 || limit == 0) {
+        split_tokens(out, policy.tokenizer(begin, end, limit));
+        return;
+    }
+
+    // cut the range into chunks at split points
+    std::vector<const char*> cuts(threads + 1);
+    cuts[0] = begin;
+    for (unsigned int i = 1; i < threads; ++i) {
+        const char* p = begin + size / threads * i;
+        cuts[i] = policy.cut(std::max(p, cuts[i - 1]), end);
+    }
+    cuts[threads] = end;
+
+    // tokenize the chunks concurrently
+    std::vector<std::vector<string_ref> > parts(threads);
+    split_parallel_run(threads, [&](unsigned int i) {
+        split_tokens(parts[i], policy.tokenizer(cuts[i], cuts[i + 1]));
+    });
+
+    // stitch the parts together, the last one after limit - 1 parts spans the
+    // remainder of the range
+    std::vector<size_t> offset(threads + 1, out.size());
+    size_t total = 0;
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        if (total == limit) {
+            parts[i].clear();
+        }
+        else if (total + parts[i].size() >= limit) {
+            parts[i].resize(limit - total);
+            parts[i].back() = string_ref(parts[i].back().begin(), end);
+            total = limit;
+        }
+        else {
+            total += parts[i].size();
+        }
+        offset[i + 1] = out.size() + total;
+    }
+
+    // construct the output values concurrently
+    out.resize(offset[threads]);
+    split_parallel_run(threads, [&](unsigned int i) {
+        for (size_t j = 0; j < parts[i].size(); ++j)
+            out[offset[i] + j] = Value(parts[i][j].begin(), parts[i][j].end());
+    });
+}
+
+/**
+ * Split the given string at each separator character like split(), but
+ * tokenize chunks of the string concurrently. The result is identical to
+ * split(), including the limit.
+ *
+ * @param str           string to split
+ * @param sep           separator character
+ * @param limit         maximum number of parts returned
+ * @param threads       number of threads, or zero for one per core
+ * @return              vector containing each split substring
+ */
+static inline std::vector<std::string> split_parallel(const std::string& str, char sep, std::string::size_type limit = std::string::npos, unsigned int threads = 0)
+{
+    std::vector<std::string> out;
+    split_parallel_algorithm(out, str.data(), str.data() + str.size(),
+                             split_parallel_char(sep), limit, threads);
+    return out;
+}
+
+/**
+ * Split the given string at each separator character like split_view(), but
+ * tokenize chunks of the string concurrently. The referenced string must
+ * outlive the returned vector.
+ *
+ * @param str           string to split
+ * @param sep           separator character
+ * @param limit         maximum number of parts returned
+ * @param threads       number of threads, or zero for one per core
+ * @return              vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_view_parallel(const string_ref& str, char sep, std::string::size_type limit = std::string::npos, unsigned int threads = 0)
+{
+    std::vector<string_ref> out;
+    split_parallel_algorithm(out, str.begin(), str.end(),
+                             split_parallel_char(sep), limit, threads);
+    return out;
+}
+
+/**
+ * Split the given string by whitespaces like split_ws(), but tokenize chunks
+ * of the string concurrently. The result is identical to split_ws(),
+ * including the limit.
+ *
+ * @param str           string to split
+ * @param limit         maximum number of parts returned
+ * @param threads       number of threads, or zero for one per core
+ * @return              vector containing each split substring
+ */
+static inline std::vector<std::string> split_ws_parallel(const std::string& str, std::string::size_type limit = std::string::npos, unsigned int threads = 0)
+{
+    std::vector<std::string> out;
+    split_parallel_algorithm(out, str.data(), str.data() + str.size(),
+                             split_parallel_ws(), limit, threads);
+    return out;
+}
+
+/**
+ * Split the given string by whitespaces like split_ws_view(), but tokenize
+ * chunks of the string concurrently. The referenced string must outlive the
+ * returned vector.
+ *
+ * @param str           string to split
+ * @param limit         maximum number of parts returned
+ * @param threads       number of threads, or zero for one per core
+ * @return              vector containing a reference to each split substring
+ */
+static inline std::vector<string_ref> split_ws_view_parallel(const string_ref& str, std::string::size_type limit = std::string::npos, unsigned int threads = 0)
+{
+    std::vector<string_ref> out;
+    split_parallel_algorithm(out, str.begin(), str.end(),
+                             split_parallel_ws(), limit, threads);
+    return out;
+}
+
+#endif // STX_STRING_THREADS
+
+// *** Join Functions ***
+
+/**
+ * Append a sequence of pieces glued together to the output string. Single pass
+ * version for input iterators.
+ */
+template <typename input_iterator>
+static inline void join_to_algorithm(std::string& out, const std::string& glue, input_iterator first, input_iterator last, std::input_iterator_tag)
+{
+    if (first == last) return;
+
+    concat_piece(*first).append(out);
+    ++first;
+
+    while( first != last )
+    {
+        out.append(glue);
+        concat_piece(*first).append(out);
+        ++first;
+    }
+}
+
+/**
+ * Append a sequence of pieces glued together to the output string. Version for
+ * forward iterators, which calculates the total length in a first pass and
+ * then grows the output at most once.
+ */
+template <typename forward_iterator>
+static inline void join_to_algorithm(std::string& out, const std::string& glue, forward_iterator first, forward_iterator last, std::forward_iterator_tag)
+{
+    if (first == last) return;
+
+    std::string::size_type size = out.size();
+    for (forward_iterator it = first; it != last; ++it)
+        size += concat_piece(*it).size() + glue.size();
+
+    out.reserve(size - glue.size());
+
+    join_to_algorithm(out, glue, first, last, std::input_iterator_tag());
+}
+
+/**
+ * Join a sequence of pieces by some glue string between each pair and append
+ * the result to a caller-owned string. The pieces may be strings, string_refs,
+ * C strings, characters or integers. For forward iterators, the output is
+ * grown at most once.
+ *
+ * @param out   string to append to
+ * @param glue  string to glue
+ * @param first the beginning iterator of the range to join
+ * @param last  the ending iterator of the range to join
+ * @return      reference to out
+ */
+template <typename input_iterator>
+static inline std::string& join_to(std::string& out, const std::string& glue, input_iterator first, input_iterator last)
+{
+    join_to_algorithm(
+        out, glue, first, last,
+        typename std::iterator_traits<input_iterator>::iterator_category());
+    return out;
+}
+
+/**
+ * Join a sequence of strings by some glue string between each pair from the
+ * sequence. The sequence in given as a range between two iterators. The
+ * pieces may also be string_refs, C strings, characters or integers. For
+ * forward iterators, the total length is calculated in advance and the result
+ * is allocated once.
+ *
+ * @param glue  string to glue
+ * @param first the beginning iterator of the range to join
+ * @param last  the ending iterator of the range to join
+ * @return      string constructed from the range with the glue between two strings.
+ */
+template <typename input_iterator>
+static inline std::string join(const std::string& glue, input_iterator first, input_iterator last)
+{
+    std::string out;
+    join_to(out, glue, first, last);
+    return out;
+}
+
+/**
+ * Join a vector of strings by some glue string between each pair from the
+ * sequence.
+ *
+ * @param glue  string to glue
+ * @param parts the vector of strings to join
+ * @return      string constructed from the vector with the glue between two strings.
+ */
+static inline std::string join(const std::string& glue, const std::vector<std::string>& parts)
+{
+    return join(glue, parts.begin(), parts.end());
+}
+
+/**
+ * Join all strings of a string table by some glue string between each pair.
+ * The result is allocated once with its exact size.
+ *
+ * @param glue  string to glue
+ * @param parts the string table to join
+ * @return      string constructed from the table with the glue between two strings.
+ */
+static inline std::string join(const std::string& glue, const string_table& parts)
+{
+    std::string out;
+    if (parts.empty()) return out;
+
+    out.reserve(parts.chars() + glue.size() * (parts.size() - 1));
+
+    out.append(parts[0].data(), parts[0].size());
+
+    for (string_table::size_type i = 1; i < parts.size(); ++i)
+    {
+        out.append(glue);
+        out.append(parts[i].data(), parts[i].size());
+    }
+
+    return out;
+}
+
+// ***                                 ***
+// *** Streaming Record Reader Classes ***
+// ***                                 ***
+
+/**
+ * Record source reading from a std::istream, for use with
+ * basic_record_reader.
+ */
+class istream_record_source
+{
+public:
+    explicit istream_record_source(std::istream& is)
+        : m_is(&is)
+    { }
+
+    //! read up to size bytes into data, returns zero at end of stream
+    std::string::size_type read(char* data, std::string::size_type size)
+    {
+        m_is->read(data, static_cast<std::streamsize>(size));
+        return static_cast<std::string::size_type>(m_is->gcount());
+    }
+
+private:
+    //! stream to read from
+    std::istream* m_is;
+};
+
+/**
+ * Streaming reader delivering delimiter-terminated records, usually lines, of
+ * an arbitrarily large input. The input is read in large chunks into one
+ * reusable buffer, in which the record boundaries are located by the same
+ * scanning kernels as in split(). Each record is returned as string_ref into
+ * the buffer, without the delimiter, and is valid until the next call to
+ * next(). Only a record straddling the end of the buffer is moved to its
+ * front before reading the next chunk, and the buffer only grows if a single
+ * record is longer than it. A final record without delimiter is also
+ * returned.
+ *
+ * The Source must provide a method size_type read(char* data, size_type size)
+ * which returns zero at the end of the input.
+ */
+template <typename Source>
+class basic_record_reader
+{
+public:
+    typedef std::string::size_type size_type;
+
+    /**
+     * Initialize reader.
+     *
+     * @param source        input to read from
+     * @param delim         record delimiter
+     * @param chunk_size    size of the buffer and of each read
+     */
+    explicit basic_record_reader(const Source& source, char delim = '\n',
+                                 size_type chunk_size = 1024 * 1024)
+        : m_source(source), m_delim(delim),
+          m_buffer(chunk_size == 0 ? 1 : chunk_size),
+          m_pos(0), m_scan(0), m_fill(0), m_eof(false)
+    { }
+
+    /**
+     * Read the next record. Returns false if the input is exhausted.
+     *
+     * @param record    receives a reference to the record in the buffer
+     * @return          true if a record was returned
+     */
+    bool next(string_ref& record)
+    {
+        while (true)
+        {
+            const char* data = &m_buffer[0];
+            const char* it = find_char(data + m_scan, data + m_fill, m_delim);
+
+            if (it != data + m_fill) {
+                record = string_ref(data + m_pos, it);
+                m_pos = m_scan = static_cast<size_type>(it - data) + 1;
+                return true;
+            }
+
+            if (m_eof) {
+                if (m_pos == m_fill) return false;
+                record = string_ref(data + m_pos, data + m_fill);
+                m_pos = m_scan = m_fill;
+                return true;
+            }
+
+            refill();
+        }
+    }
+
+private:
+    //! source of the input data
+    Source m_source;
+
+    //! record delimiter
+    char m_delim;
+
+    //! chunk buffer
+    std::vector<char> m_buffer;
+
+    //! start of the next record, end of scanned part and end of data
+    size_type m_pos, m_scan, m_fill;
+
+    //! true if the source is exhausted
+    bool m_eof;
+
+    //! move the incomplete record to the front and read the next chunk
+    void refill()
+    {
+        if (m_pos != 0) {
+            std::copy(m_buffer.begin() + m_pos, m_buffer.begin() + m_fill,
+                      m_buffer.begin());
+            m_scan = m_fill -= m_pos;
+            m_pos = 0;
+        }
+        else {
+            m_scan = m_fill;
+        }
+
+        // a record longer than the buffer: double the buffer
+        if (m_fill == m_buffer.size())
+            m_buffer.resize(2 * m_buffer.size());
+
+        size_type rb = m_source.read(&m_buffer[m_fill], m_buffer.size() - m_fill);
+        if (rb == 0) m_eof = true;
+        m_fill += rb;
+    }
+};
+
+/** Streaming record reader over a std::istream. */
+typedef basic_record_reader<istream_record_source> istream_record_reader;
+
+// ***                         ***
+// *** Random String Functions ***
+// ***                         ***
+
+/**
+ * Generate a random binary string of given length. Any byte from 0-256 is
+ * equally probable. Uses the pseudo-random number generator from stdlib; take
+ * care to seed it using srand() before calling this function.
+ *
+ * @param size  length of result
+ * @return      random binary string of given length
+ */
+static inline std::string random_binary(std::string::size_type size)
+{
+    std::string out;
+    out.resize(size);
+
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast<unsigned char>(rand() % 256);
+
+    return out;
+}
+
+/**
+ * Generate a random string of given length. The set of available
+ * bytes/characters is given as the second argument. Each byte is equally
+ * probable. Uses the pseudo-random number generator from stdlib; take care to
+ * seed it using srand() before calling this function.
+ *
+ * @param size  length of result
+ * @param cset  character set to choose from
+ * @return      random string of given length
+ */
+static inline std::string random(std::string::size_type size, const std::string& cset)
+{
+    std::string out;
+    out.resize(size);
+
+    for (size_t i = 0; i < size; ++i)
+        out[i] = cset[ rand() % cset.size() ];
+
+    return out;
+}
+
+/**
+ * Generate a random string of given length. Any letter A-Z and a-z is equally
+ * probable to occur. Uses the pseudo-random number generator from stdlib; take
+ * care to seed it using srand() before calling this function.
+ *
+ * @param size  length of result
+ * @return      random string of given length
+ */
+static inline std::string random_alpha(std::string::size_type size)
+{
+    static const std::string letters =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+    return random(size, letters);
+}
+
+/**
+ * Generate a random string of given length. Any letter A-Z and a-z or digit
+ * 0-9 is equally probable to occur. Uses the pseudo-random number generator
+ * from stdlib; take care to seed it using srand() before calling this
+ * function.
+ *
+ * @param size  length of result
+ * @return      random string of given length
+ */
+static inline std::string random_alphanumeric(std::string::size_type size)
+{
+    static const std::string letters =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+    return random(size, letters);
+}
+
+// ***                           ***
+// *** Hexadecimal Dump and Load ***
+// ***                           ***
+
+/**
+ * Dump a (binary) string as a sequence of hexadecimal pairs.
+ *
+ * @param str   string to output in hex
+ * @return      string of hexadecimal pairs
+ */
+static inline std::string hexdump(const std::string& str)
+{
+    std::string out;
+    out.resize( str.size() * 2 );
+
+    static const char xdigits[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+    };
+
+    std::string::iterator oi = out.begin();
+    for (std::string::const_iterator si = str.begin();
+         si != str.end(); ++si)
+    {
+        *oi++ = xdigits[ (*si & 0xF0) >> 4 ];
+        *oi++ = xdigits[ (*si & 0x0F) ];
+    }
+
+    return out;
+}
+
+/**
+ * Dump a (binary) memory buffer as a sequence of hexadecimal pairs.
+ *
+ * @param data  pointer to input
+ * @param len   length of input
+ * @return      string of hexadecimal pairs
+ */
+static inline std::string hexdump(const void* data, size_t len)
+{
+    return hexdump(std::string(static_cast<const char*>(data),len));
+}
+
+/**
+ * Read a string as a sequence of hexadecimal pairs. Converts each pair of
+ * hexadecimal digits into a byte of the output string. Throws
+ * std::runtime_error() if an unknown letter is encountered.
+ *
+ * @param str   string to parse as hex digits
+ * @return      string of read bytes
+ */
+static inline std::string parse_hexdump(const std::string& str)
+{
+    std::string out;
+    int n = 0;
+    unsigned char c = 0;
+
+    for (std::string::const_iterator si = str.begin();
+         si != str.end(); ++si)
+    {
+        switch(*si)
+        {
+        case '0': c |= 0; break;
+        case '1': c |= 1; break;
+        case '2': c |= 2; break;
+        case '3': c |= 3; break;
+        case '4': c |= 4; break;
+        case '5': c |= 5; break;
+        case '6': c |= 6; break;
+        case '7': c |= 7; break;
+        case '8': c |= 8; break;
+        case '9': c |= 9; break;
+        case 'A': case 'a': c |= 10; break;
+        case 'B': case 'b': c |= 11; break;
+        case 'C': case 'c': c |= 12; break;
+        case 'D': case 'd': c |= 13; break;
+        case 'E': case 'e': c |= 14; break;
+        case 'F': case 'f': c |= 15; break;
+        default:
+            throw(std::runtime_error("Invalid string for hex conversion"));
+        }
+
+        if (n == 0) {
+            c *= 0x10;
+        }
+        else if (n == 1) {
+            out.append(1, c);
+            c = 0;
+        }
+        n = (n+1) % 2;
+    }
+
+    if (n != 0) throw(std::runtime_error("Invalid string for hex conversion"));
+
+    return out;
+}
+
+/**
+ * Dump a (binary) string into a C source code snippet. The snippet defines an
+ * array of const char holding the data of the string. Cannot set a default
+ * argument for varname, because it leads to ambiguous calls with the object
+ * method below.
+ *
+ * @param str           string to output as C source array
+ * @param varname       name of the array variable in the outputted code snippet
+ * @return              string holding C source snippet
+ */
+static inline std::string hexdump_sourcecode(const std::string& str, const std::string& varname)
+{
+    std::ostringstream header;
+    header << "const char " << varname << "[" << str.size() << "] = {\n";
+
+    static const int perline = 16;
+
+    std::string out = header.str();
+    out.reserve( out.size() + (str.size() * 5) - 1 + (str.size() / 16) + 4 );
+
+    static const char xdigits[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+    };
+
+    std::string::size_type ci = 0;
+
+    for (std::string::const_iterator si = str.begin();
+         si != str.end(); ++si, ++ci)
+    {
+        out.append("0x");
+        out.append(1, xdigits[ (*si & 0xF0) >> 4 ]);
+        out.append(1, xdigits[ (*si & 0x0F) ]);
+
+        if (ci+1 < str.size()) {
+            out.append(1, ',');
+
+            if (ci % perline == perline-1) {
+                out.append(1, '\n');
+            }
+        }
+    }
+
+    out.append("\n};\n");
+
+    return out;
+}
+
+// ***                              ***
+// *** Base64 Encoding and Decoding ***
+// ***                              ***
+
+/**
+ * Encode the given binary string into Base64 representation as described in
+ * RFC 2045 or RFC 3548. The output string contains only characters
+ * [A-Za-z0-9+/] and is roughly 33% longer than the input. The output string
+ * can be broken into lines after n characters, where n must be a multiple of
+ * 4. The function's code is based on code from the libb64 project (see
+ * http://sourceforge.net/projects/libb64).
+ *
+ * @param instr         input string to encode
+ * @param linebreak     break the output string every n characters
+ * @return              base64 encoded string
+ */
+static inline std::string base64_encode(const std::string& instr, size_t linebreak = 0)
+{
+    std::string::const_iterator inchar = instr.begin();
+    std::string outstr;
+
+    if (instr.size() == 0) return outstr;
+
+    // calculate output string's size in advance
+    size_t outsize = (((instr.size() - 1) / 3) + 1) * 4;
+    if (linebreak > 0) outsize += outsize / linebreak;
+    outstr.reserve( outsize );
+
+    static const char encoding64[65]
+        = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char result = 0;
+    size_t linebegin = 0;
+
+    while (1)
+    {
+        // step 0: if the string is finished here, no padding is needed
+        if (inchar == instr.end()) {
+            return outstr;
+        }
+
+        // step 0: process first byte, write first letter
+        char fragment = *inchar++;
+        result = (fragment & 0xFC) >> 2;
+        outstr += encoding64[static_cast<int>(result)];
+        result = (fragment & 0x03) << 4;
+
+        // step 1: if string finished here, add two padding '='s
+        if (inchar == instr.end()) {
+            outstr += encoding64[static_cast<int>(result)];
+            outstr += '=';
+            outstr += '=';
+            return outstr;
+        }
+
+        // step 1: process second byte together with first, write second
+        // letter
+        fragment = *inchar++;
+        result |= (fragment & 0xF0) >> 4;
+        outstr += encoding64[static_cast<int>(result)];
+        result = (fragment & 0x0F) << 2;
+
+        // step 2: if string finished here, add one padding '='
+        if (inchar == instr.end()) {
+            outstr += encoding64[static_cast<int>(result)];
+            outstr += '=';
+            return outstr;
+        }
+
+        // step 2: process third byte and write third and fourth letters.
+        fragment = *inchar++;
+
+        result |= (fragment & 0xC0) >> 6;
+        outstr += encoding64[static_cast<int>(result)];
+
+        result  = (fragment & 0x3F) >> 0;
+        outstr += encoding64[static_cast<int>(result)];
+
+        // wrap base64 encoding into lines if desired, but only after whole
+        // blocks of 4 letters.
+        if (linebreak > 0 && outstr.size() - linebegin >= linebreak)
+        {
+            outstr += '\n';
+            linebegin = outstr.size();
+        }
+    }
+}
+
+/**
+ * Decode a stringin Base64 representation as described in RFC 2045 or RFC 3548
+ * and return the original data. If a non-whitespace invalid Base64 character
+ * is encountered _and_ the parameter "strict" is true, then this function will
+ * throw a std::runtime_error. If "strict" is false, the character is silently
+ * ignored. The function's code is based on code from the libb64 project (see
+ * http://sourceforge.net/projects/libb64).
+ *
+ * @param instr         input string to encode
+ * @param strict        throw exception on invalid character
+ * @return              decoded binary data
+ */
+static inline std::string base64_decode(const std::string& instr, bool strict = false)
+{
+    std::string::const_iterator inchar = instr.begin();
+    std::string outstr;
+
+    // estimate the output size, assume that the whole input string is
+    // base64 encoded.
+    outstr.reserve( instr.size() * 3 / 4 );
+
+    // value lookup table: -1 -> exception, -2 -> skip whitespace
+    const char decoding64[256] = {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -2, -2, -1, -1, -2, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+        52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -2, -1, -1,
+        -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+        -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+    };
+
+    char outchar;
+    char fragment;
+
+    while (1)
+    {
+        // step 0: save first valid letter. do not output a byte, yet.
+        do {
+            if (inchar == instr.end()) return outstr;
+
+            fragment = decoding64[ static_cast<int>(*inchar++) ];
+
+            if (fragment == -1 && strict)
+                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+
+        } while (fragment < 0);
+
+        outchar = (fragment & 0x3F) << 2;
+
+        // step 1: get second valid letter. output the first byte.
+        do {
+            if (inchar == instr.end()) return outstr;
+
+            fragment = decoding64[ static_cast<int>(*inchar++) ];
+
+            if (fragment == -1 && strict)
+                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+
+        } while (fragment < 0);
+
+        outchar |= (fragment & 0x30) >> 4;
+        outstr += outchar;
+
+        outchar = (fragment & 0x0F) << 4;
+
+        // step 2: get third valid letter. output the second byte.
+        do {
+            if (inchar == instr.end())  return outstr;
+
+            fragment = decoding64[ static_cast<int>(*inchar++) ];
+
+            if (fragment == -1 && strict)
+                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+
+        } while (fragment < 0);
+
+        outchar |= (fragment & 0x3C) >> 2;
+        outstr += outchar;
+
+        outchar = (fragment & 0x03) << 6;
+
+        // step 3: get fourth valid letter. output the third byte.
+        do {
+            if (inchar == instr.end()) return outstr;
+
+            fragment = decoding64[ static_cast<int>(*inchar++) ];
+
+            if (fragment == -1 && strict)
+                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+
+        } while (fragment < 0);
+
+        outchar |= (fragment & 0x3F);
+        outstr += outchar;
+    }
+}
+
+/*** URI Encoding and Decoding ************************************************/
+
+/**
+ * Decode a uri escaped string, mapping sequences like %0A to their original
+ * character values. The transformation is done in-place.
+ *
+ * @param str		input string to decode
+ */
+static inline void uri_decode_inplace(std::string& str)
+{
+    static const char hex2dec[256] =
+        {
+            /*       0  1  2  3   4  5  6  7   8  9  A  B   C  D  E  F */
+            /* 0 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 1 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 2 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 3 */  0, 1, 2, 3,  4, 5, 6, 7,  8, 9,-1,-1, -1,-1,-1,-1,
+
+            /* 4 */ -1,10,11,12, 13,14,15,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 5 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 6 */ -1,10,11,12, 13,14,15,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 7 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+
+            /* 8 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* 9 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* A */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* B */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+
+            /* C */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* D */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* E */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+            /* F */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1
+        };
+
+    char dec1, dec2;
+    size_t p = 0, q = 0;
+
+    while (p < str.length())
+    {
+        if (str[p] == '%' &&
+            p + 2 < str.length() &&
+            (dec1 = hex2dec[static_cast<int>(str[p+1])]) >= 0 &&
+            (dec2 = hex2dec[static_cast<int>(str[p+2])]) >= 0)
+        {
+            str[q++] = (dec1 << 4) + dec2;
+            p += 3;
+        }
+        else
+        {
+            str[q++] = str[p++];
+        }
+    }
+    str.resize(q);
+}
+
+/*** Levenshtein String Distance **********************************************/
+
+// *** Parameter Struct and Algorithm ***
+
+/**
+ * Standard parameters to levenshtein distance function. Costs are all 1 and
+ * characters are compared directly.
+ */
+struct LevenshteinStandard
+{
+    static const unsigned int cost_insert_delete        = 1;
+    static const unsigned int cost_replace              = 1;
+
+    static inline bool char_equal(const char& a, const char& b)
+    { return (a == b); }
+};
+
+/**
+ * Standard parameters to Levenshtein distance function. Costs are all 1 and
+ * characters are compared case-insensitively.
+ */
+struct LevenshteinStandardICase
+{
+    static const unsigned int cost_insert_delete        = 1;
+    static const unsigned int cost_replace              = 1;
+
+    static inline bool char_equal(const char& a, const char& b)
+    { return std::tolower(a) == std::tolower(b); }
+};
+
+/**
+ * Computes the Levenshtein string distance between two strings. The distance
+ * is the minimum number of replacements/inserts/deletes needed to change one
+ * string into the other. Implemented with time complexity O(|n|+|m|) and
+ * memory complexity O(2*max(|n|,|m|))
+ *
+ * @param a     first string
+ * @param b     second string
+ * @return      Levenshtein distance
+ */
+template <typename levenshtein_param>
+static inline size_t levenshtein_algorithm(const std::string& a, const std::string& b)
+{
+    // if one of the strings is zero, then all characters of the other must
+    // be inserted.
+    if (a.empty()) return b.size();
+    if (b.empty()) return a.size();
+
+    // make "as" the longer string and "bs" the shorter.
+    const std::string &as = (a.size() > b.size()) ? a : b;
+    const std::string &bs = (a.size() > b.size()) ? b : a;
+
+    // only allocate two rows of the needed matrix.
+    std::vector<size_t> lastrow(as.size() + 1);
+    std::vector<size_t> thisrow(as.size() + 1);
+
+    // fill this row with ascending ordinals.
+    for(size_t i = 0; i < as.size() + 1; i++) {
+        thisrow[i] = i;
+    }
+
+    // compute distance
+    for (size_t j = 1; j < bs.size() + 1; j++)
+    {
+        // switch rows
+        std::swap(lastrow, thisrow);
+
+        // compute new row
+        thisrow[0] = j;
+
+        for(size_t i = 1; i < as.size() + 1; i++)
+        {
+            // three-way mimimum of
+            thisrow[i] = std::min(
+                std::min(
+                    // left plus insert cost
+                    thisrow[i-1] + levenshtein_param::cost_insert_delete,
+                    // top plus delete cost
+                    lastrow[i] + levenshtein_param::cost_insert_delete),
+                // top left plus replacement cost
+                lastrow[i-1] + (levenshtein_param::char_equal(as[i-1], bs[j-1]) ? 0 : levenshtein_param::cost_replace)
+                );
+        }
+    }
+
+    // result is in the last cell of the last computed row
+    return thisrow[ as.size() ];
+}
+
+// *** static inline Wrapper Functions ***
+
+/**
+ * Computes the Levenshtein string distance between two strings. The distance
+ * is the minimum number of replacements/inserts/deletes needed to change one
+ * string into the other.
+ *
+ * @param a     first string
+ * @param b     second string
+ * @return      Levenshtein distance
+ */
+static inline size_t levenshtein(const std::string& a, const std::string& b)
+{
+    return levenshtein_algorithm<LevenshteinStandard>(a, b);
+}
+
+/**
+ * Computes the Levenshtein string distance between two strings. The distance
+ * is the minimum number of replacements/inserts/deletes needed to change one
+ * string into the other. Character comparison is done case-insensitively.
+ *
+ * @param a     first string
+ * @param b     second string
+ * @return      Levenshtein distance
+ */
+static inline size_t levenshtein_icase(const std::string& a, const std::string& b)
+{
+    return levenshtein_algorithm<LevenshteinStandardICase>(a, b);
+}
+
+// ***                ***
+// *** String Sorting ***
+// ***                ***
+
+/*
+ * The string sorting functions sort arrays of string_ref in place with MSD
+ * radix sort on large subproblems, multikey quicksort (Bentley and
+ * Sedgewick) on medium and insertion sort on small ones. All three inspect
+ * each character of a common prefix only once or a few times, instead of
+ * comparing whole strings again and again like std::sort(). The order is the
+ * same as operator< of std::string, or less_icase() with fold_case. The
+ * relative order of equal strings is unspecified.
+ */
+
+//! subproblems of at most this many strings are insertion sorted
+static const size_t string_sort_insertion_cutoff = 16;
+
+//! subproblems of at least this many strings are radix sorted
+static const size_t string_sort_radix_cutoff = 4096;
+
+/** String reference with its original position, sorted by string_sort_index(). */
+struct string_sort_indexed
+{
+    //! referenced string
+    string_ref ref;
+
+    //! original position of the string
+    size_t index;
+};
+
+//! return the string referenced by an item of the string sorting functions
+static inline const string_ref& string_sort_ref(const string_ref& s)
+{
+    return s;
+}
+
+//! return the string referenced by an item of the string sorting functions
+static inline const string_ref& string_sort_ref(const string_sort_indexed& s)
+{
+    return s.ref;
+}
+
+/**
+ * Return the character of s at depth as used by the string sorting
+ * functions: zero at the end of s, which sorts before any character, or one
+ * plus the unsigned char, with fold_case as ASCII lowercase.
+ */
+template <bool FoldCase>
+static inline unsigned int string_sort_char(const string_ref& s, size_t depth)
+{
+    if (depth >= s.size()) return 0;
+
+    unsigned char c = static_cast<unsigned char>(s[depth]);
+    return 1u + (FoldCase ? ascii_case_tables<>::lower[c] : c);
+}
+
+/**
+ * Compare the suffixes of two strings starting at depth, which is at most
+ * the size of both, in the order of the string sorting functions.
+ */
+template <bool FoldCase>
+static inline bool string_sort_less(const string_ref& a, const string_ref& b, size_t depth)
+{
+    size_t n = std::min(a.size(), b.size()) - depth;
+    if (n != 0) {
+        int r = FoldCase
+            ? memcmp_icase(a.data() + depth, b.data() + depth, n)
+            : memcmp(a.data() + depth, b.data() + depth, n);
+        if (r != 0) return (r < 0);
+    }
+    return (a.size() < b.size());
+}
+
+/**
+ * Return the length of the common prefix of the n bytes at a and b, with
+ * fold_case compared case-insensitively.
+ */
+template <bool FoldCase>
+static inline size_t string_sort_mismatch(const char* a, const char* b, size_t n)
+{
+    if (FoldCase)
+        return mismatch_icase(a, b, n);
+
+    size_t l = 0;
+    while (l + 8 <= n && memcmp(a + l, b + l, 8) == 0)
+        l += 8;
+    while (l < n && a[l] == b[l])
+        ++l;
+    return l;
+}
+
+/**
+ * Return the length of the common prefix of n strings, which share at least
+ * a prefix of length depth. This skips long shared prefixes, like those of
+ * paths or URLs, at once instead of character by character.
+ */
+template <bool FoldCase, typename Item>
+static inline size_t string_sort_common_prefix(const Item* a, size_t n, size_t depth)
+{
+    const string_ref& s = string_sort_ref(a[0]);
+    size_t lcp = s.size();
+
+    for (size_t i = 1; i < n && lcp > depth; ++i)
+    {
+        const string_ref& t = string_sort_ref(a[i]);
+        size_t m = std::min(lcp, t.size());
+        lcp = depth + string_sort_mismatch<FoldCase>(
+            s.data() + depth, t.data() + depth, m - depth);
+    }
+
+    return lcp;
+}
+
+/**
+ * Sort n strings sharing a common prefix of length depth with insertion
+ * sort.
+ */
+template <bool FoldCase, typename Item>
+static inline void string_sort_insertion(Item* a, size_t n, size_t depth)
+{
+    for (size_t i = 1; i < n; ++i)
+    {
+        Item s = a[i];
+        size_t j = i;
+        while (j > 0 && string_sort_less<FoldCase>(string_sort_ref(s), string_sort_ref(a[j - 1]), depth)) {
+            a[j] = a[j - 1];
+            --j;
+        }
+        a[j] = s;
+    }
+}
+
+/**
+ * Sort n strings sharing a common prefix of length depth with multikey
+ * quicksort: the strings are partitioned three-way by their character at
+ * depth, and only the equal partition advances to the next character.
+ */
+template <bool FoldCase, typename Item>
+static inline void string_sort_mkqs(Item* a, size_t n, size_t depth)
+{
+    while (n > string_sort_insertion_cutoff)
+    {
+        // median of three pivot character
+        unsigned int c0 = string_sort_char<FoldCase>(string_sort_ref(a[0]), depth);
+        unsigned int c1 = string_sort_char<FoldCase>(string_sort_ref(a[n / 2]), depth);
+        unsigned int c2 = string_sort_char<FoldCase>(string_sort_ref(a[n - 1]), depth);
+        unsigned int pivot =
+            (c0 < c1) ? ((c1 < c2) ? c1 : (c0 < c2) ? c2 : c0)
+                      : ((c0 < c2) ? c0 : (c1 < c2) ? c2 : c1);
+
+        // partition into [0,lt) < pivot, [lt,gt) == pivot, [gt,n) > pivot
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt)
+        {
+            unsigned int c = string_sort_char<FoldCase>(string_sort_ref(a[i]), depth);
+            if (c < pivot)
+                std::swap(a[lt++], a[i++]);
+            else if (c > pivot)
+                std::swap(a[i], a[--gt]);
+            else
+                ++i;
+        }
+
+        string_sort_mkqs<FoldCase>(a, lt, depth);
+        string_sort_mkqs<FoldCase>(a + gt, n - gt, depth);
+
+        // strings which ended at depth are equal
+        if (pivot == 0) return;
+
+        if (lt == 0 && gt == n)
+            depth = string_sort_common_prefix<FoldCase>(a, n, depth);
+        else
+            a += lt, n = gt - lt, ++depth;
+    }
+
+    string_sort_insertion<FoldCase>(a, n, depth);
+}
+
+/**
+ * Sort n strings sharing a common prefix of length depth with MSD radix
+ * sort: the strings are distributed into 257 buckets by their character at
+ * depth, and each bucket is sorted recursively at the next character. The
+ * characters are cached in oracle and the strings moved through buffer,
+ * both of size n.
+ */
+template <bool FoldCase, typename Item>
+static inline void string_sort_radix(Item* a, size_t n, size_t depth,
+                                     unsigned short* oracle, Item* buffer)
+{
+    size_t bucket[257 + 1];
+
+    while (n >= string_sort_radix_cutoff)
+    {
+        std::fill(bucket, bucket + 257 + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            oracle[i] = static_cast<unsigned short>(
+                string_sort_char<FoldCase>(string_sort_ref(a[i]), depth));
+            ++bucket[oracle[i] + 1];
+        }
+
+        // skip over a common prefix without recursion
+        if (bucket[oracle[0] + 1] == n) {
+            if (oracle[0] == 0) return;
+            depth = string_sort_common_prefix<FoldCase>(a, n, depth);
+            continue;
+        }
+
+        for (unsigned int c = 1; c <= 257; ++c)
+            bucket[c] += bucket[c - 1];
+
+        size_t pos[257];
+        std::copy(bucket, bucket + 257, pos);
+        for (size_t i = 0; i < n; ++i)
+            buffer[pos[oracle[i]]++] = a[i];
+
+        std::copy(buffer, buffer + n, a);
+
+        // bucket zero holds the strings which ended at depth. Recurse into
+        // all but the largest bucket, which holds at least as many strings
+        // as any other, and continue with that one in the loop. Hence each
+        // recursion at most halves n and the stack depth is O(log n).
+        unsigned int largest = 1;
+        for (unsigned int c = 2; c < 257; ++c)
         {
-        case '0': c |= 0; break;
-        case '1': c |= 1; break;
-        case '2': c |= 2; break;
-        case '3': c |= 3; break;
-        case '4': c |= 4; break;
-        case '5': c |= 5; break;
-        case '6': c |= 6; break;
-        case '7': c |= 7; break;
-        case '8': c |= 8; break;
-        case '9': c |= 9; break;
-        case 'A': case 'a': c |= 10; break;
-        case 'B': case 'b': c |= 11; break;
-        case 'C': case 'c': c |= 12; break;
-        case 'D': case 'd': c |= 13; break;
-        case 'E': case 'e': c |= 14; break;
-        case 'F': case 'f': c |= 15; break;
-        default:
-            throw(std::runtime_error("Invalid string for hex conversion"));
+            if (bucket[c + 1] - bucket[c] > bucket[largest + 1] - bucket[largest])
+                largest = c;
         }
 
-        if (n == 0) {
-            c *= 0x10;
+        for (unsigned int c = 1; c < 257; ++c)
+        {
+            size_t begin = bucket[c], size = bucket[c + 1] - begin;
+            if (c != largest && size > 1) {
+                string_sort_radix<FoldCase>(a + begin, size, depth + 1,
+                                            oracle + begin, buffer + begin);
+            }
         }
-        else if (n == 1) {
-            out.append(1, c);
-            c = 0;
+
+        size_t begin = bucket[largest];
+        a += begin, oracle += begin, buffer += begin;
+        n = bucket[largest + 1] - begin;
+        ++depth;
+    }
+
+    if (n > 1)
+        string_sort_mkqs<FoldCase>(a, n, depth);
+}
+
+/**
+ * Sort the n strings in a, and optionally output the longest common prefix
+ * of each string and its predecessor into lcp[1..n-1], with lcp[0] = 0.
+ * With fold_case the prefixes are compared case-insensitively.
+ */
+template <bool FoldCase, typename Item>
+static inline void string_sort_algorithm(Item* a, size_t n, size_t* lcp)
+{
+    if (n >= string_sort_radix_cutoff) {
+        std::vector<unsigned short> oracle(n);
+        std::vector<Item> buffer(n);
+        string_sort_radix<FoldCase>(a, n, 0, &oracle[0], &buffer[0]);
+    }
+    else {
+        string_sort_mkqs<FoldCase>(a, n, 0);
+    }
+
+    if (lcp == NULL || n == 0) return;
+
+    lcp[0] = 0;
+    for (size_t i = 1; i < n; ++i)
+    {
+        const string_ref& x = string_sort_ref(a[i - 1]), & y = string_sort_ref(a[i]);
+        lcp[i] = string_sort_mismatch<FoldCase>(
+            x.data(), y.data(), std::min(x.size(), y.size()));
+    }
+}
+
+/**
+ * Sort a vector of string references in place, in the same order as
+ * operator< of std::string or less_icase(), using MSD radix sort and
+ * multikey quicksort. Only the references are moved.
+ *
+ * @param v             vector of string references to sort
+ * @param fold_case     sort case-insensitively like less_icase()
+ * @param lcp           optional output: lcp[i] is the length of the longest
+ *                      common prefix of v[i-1] and v[i], and lcp[0] = 0
+ */
+static inline void string_sort(std::vector<string_ref>& v, bool fold_case = false,
+                               std::vector<size_t>* lcp = NULL)
+{
+    if (lcp) lcp->resize(v.size());
+
+    string_ref* a = v.empty() ? NULL : &v[0];
+    size_t* l = (lcp && !v.empty()) ? &(*lcp)[0] : NULL;
+
+    if (fold_case)
+        string_sort_algorithm<true>(a, v.size(), l);
+    else
+        string_sort_algorithm<false>(a, v.size(), l);
+}
+
+/**
+ * Calculate the permutation which sorts a vector of strings, in the same
+ * order as operator< of std::string or less_icase(), using MSD radix sort and
+ * multikey quicksort. The strings are not moved.
+ *
+ * @param v             vector of strings to sort
+ * @param fold_case     sort case-insensitively like less_icase()
+ * @param lcp           optional output: lcp[i] is the length of the longest
+ *                      common prefix of the i-1-th and i-th sorted string
+ * @return              indexes into v of the strings in sorted order
+ */
+static inline std::vector<size_t> string_sort_index(const std::vector<std::string>& v, bool fold_case = false,
+                                                    std::vector<size_t>* lcp = NULL)
+{
+    size_t n = v.size();
+    if (lcp) lcp->resize(n);
+    if (n == 0) return std::vector<size_t>();
+
+    std::vector<string_sort_indexed> items(n);
+    for (size_t i = 0; i < n; ++i) {
+        items[i].ref = string_ref(v[i]);
+        items[i].index = i;
+    }
+
+    size_t* l = lcp ? &(*lcp)[0] : NULL;
+
+    if (fold_case)
+        string_sort_algorithm<true>(&items[0], n, l);
+    else
+        string_sort_algorithm<false>(&items[0], n, l);
+
+    std::vector<size_t> index(n);
+    for (size_t i = 0; i < n; ++i)
+        index[i] = items[i].index;
+    return index;
+}
+
+/**
+ * Sort a vector of strings in the same order as operator< of std::string or
+ * less_icase(), using MSD radix sort and multikey quicksort on references
+ * to the strings, which are then swapped into place.
+ *
+ * @param v             vector of strings to sort
+ * @param fold_case     sort case-insensitively like less_icase()
+ * @param lcp           optional output: lcp[i] is the length of the longest
+ *                      common prefix of v[i-1] and v[i], and lcp[0] = 0
+ */
+static inline void string_sort(std::vector<std::string>& v, bool fold_case = false,
+                               std::vector<size_t>* lcp = NULL)
+{
+    std::vector<size_t> index = string_sort_index(v, fold_case, lcp);
+
+    std::vector<std::string> sorted(v.size());
+    for (size_t i = 0; i < index.size(); ++i)
+        sorted[i].swap(v[index[i]]);
+    v.swap(sorted);
+}
+
+// ***                            ***
+// *** 'Natural Order' Comparison ***
+// ***                            ***
+
+// *** Algorithm and Helper Functions ***
+
+//! natcmp_tables character class of whitespace, like std::isspace() in the
+//! C locale
+static const unsigned char natcmp_space = 1;
+
+//! natcmp_tables character class of the digits '0'-'9'
+static const unsigned char natcmp_digit = 2;
+
+#define STX_STRING_NAT_CLASS(c)                                           \
+    static_cast<unsigned char>(                                           \
+        ((c) == ' ' || ((c) >= '\t' && (c) <= '\r')) ? natcmp_space :     \
+        ((c) >= '0' && (c) <= '9') ? natcmp_digit : 0)
+
+#define STX_STRING_NAT_ROW(r)                                                           \
+    STX_STRING_NAT_CLASS(r + 0), STX_STRING_NAT_CLASS(r + 1),                           \
+    STX_STRING_NAT_CLASS(r + 2), STX_STRING_NAT_CLASS(r + 3),                           \
+    STX_STRING_NAT_CLASS(r + 4), STX_STRING_NAT_CLASS(r + 5),                           \
+    STX_STRING_NAT_CLASS(r + 6), STX_STRING_NAT_CLASS(r + 7),                           \
+    STX_STRING_NAT_CLASS(r + 8), STX_STRING_NAT_CLASS(r + 9),                           \
+    STX_STRING_NAT_CLASS(r + 10), STX_STRING_NAT_CLASS(r + 11),                         \
+    STX_STRING_NAT_CLASS(r + 12), STX_STRING_NAT_CLASS(r + 13),                         \
+    STX_STRING_NAT_CLASS(r + 14), STX_STRING_NAT_CLASS(r + 15)
+
+#define STX_STRING_NAT_TABLE                                              \
+    {                                                                     \
+        STX_STRING_NAT_ROW(0), STX_STRING_NAT_ROW(16),                    \
+        STX_STRING_NAT_ROW(32), STX_STRING_NAT_ROW(48),                   \
+        STX_STRING_NAT_ROW(64), STX_STRING_NAT_ROW(80),                   \
+        STX_STRING_NAT_ROW(96), STX_STRING_NAT_ROW(112),                  \
+        STX_STRING_NAT_ROW(128), STX_STRING_NAT_ROW(144),                 \
+        STX_STRING_NAT_ROW(160), STX_STRING_NAT_ROW(176),                 \
+        STX_STRING_NAT_ROW(192), STX_STRING_NAT_ROW(208),                 \
+        STX_STRING_NAT_ROW(224), STX_STRING_NAT_ROW(240)                  \
+    }
+
+/**
+ * Character class table of the 'natural order' comparison indexed by
+ * unsigned char, which replaces the locale-dependent std::isspace() and
+ * std::isdigit() calls.
+ */
+template <typename Dummy = void>
+struct natcmp_tables
+{
+#if __cplusplus >= 201103L
+    //! natcmp_space, natcmp_digit or zero for each byte
+    static constexpr unsigned char cclass[256] = STX_STRING_NAT_TABLE;
+#else
+    //! natcmp_space, natcmp_digit or zero for each byte
+    static const unsigned char cclass[256];
+#endif
+};
+
+#if __cplusplus >= 201103L
+template <typename Dummy>
+constexpr unsigned char natcmp_tables<Dummy>::cclass[256];
+#else
+template <typename Dummy>
+const unsigned char natcmp_tables<Dummy>::cclass[256] = STX_STRING_NAT_TABLE;
+#endif
+
+#undef STX_STRING_NAT_CLASS
+#undef STX_STRING_NAT_ROW
+#undef STX_STRING_NAT_TABLE
+
+//! return the natcmp_tables character class of c
+static inline unsigned char natcmp_class(char c)
+{
+    return natcmp_tables<>::cclass[static_cast<unsigned char>(c)];
+}
+
+/**
+ * Return the value by which natcmp_algorithm() orders a non-digit character:
+ * the plain (signed or unsigned) char, or with fold_case its ASCII uppercase
+ * as unsigned char.
+ */
+static inline int natcmp_value(char c, bool fold_case)
+{
+    if (fold_case)
+        return ascii_case_tables<>::upper[static_cast<unsigned char>(c)];
+    return c;
+}
+
+/**
+ * Advance ai and bi over the equal bytes at their front which are no digits,
+ * eight bytes at a time using SWAR arithmetic. With fold_case ASCII letters
+ * of different case are equal. Both iterators must be at the start of a token
+ * in natcmp_algorithm().
+ */
+static inline void natcmp_skip_equal(const char*& ai, const char* ae,
+                                     const char*& bi, const char* be,
+                                     bool fold_case)
+{
+    const unsigned long long ones = 0x0101010101010101ull;
+
+    while (ae - ai >= 8 && be - bi >= 8)
+    {
+        unsigned long long wa, wb;
+        memcpy(&wa, ai, 8);
+        memcpy(&wb, bi, 8);
+
+        if (fold_case) {
+            // clear 0x20 in each byte 'a'-'z', see hash_icase()
+            unsigned long long la = wa & (0x7F * ones), lb = wb & (0x7F * ones);
+            wa &= ~((((la + (0x80 - 'a') * ones) ^ (la + (0x7F - 'z') * ones))
+                     & ~wa & (0x80 * ones)) >> 2);
+            wb &= ~((((lb + (0x80 - 'a') * ones) ^ (lb + (0x7F - 'z') * ones))
+                     & ~wb & (0x80 * ones)) >> 2);
         }
-        n = (n+1) % 2;
+
+        // the high bit of a byte in d is set if any byte of wa is a digit
+        unsigned long long x = wa ^ ('0' * ones);
+        unsigned long long d = (x - 10 * ones) & ~x & (0x80 * ones);
+
+        if ((wa ^ wb) != 0 || d != 0) break;
+
+        ai += 8, bi += 8;
     }
 
-    if (n != 0) throw(std::runtime_error("Invalid string for hex conversion"));
+    while (ai != ae && bi != be &&
+           natcmp_value(*ai, fold_case) == natcmp_value(*bi, fold_case) &&
+           natcmp_class(*ai) != natcmp_digit)
+    {
+        ++ai, ++bi;
+    }
+}
 
-    return out;
+/**
+ * Function to compare two (binary) character ranges using the 'natural
+ * order' comparison algorithm written by Martin Pool. I converted the C code
+ * using C-style strings to STL-style string processing. The character classes
+ * are looked up in a table instead of the current locale and equal prefixes
+ * are skipped word-wise. The equivalence to the original algorithm is
+ * verified in the test suite.
+ *
+ * Based on:
+ *
+ * strnatcmp.c -- Perform 'natural order' comparisons of strings in C.
+ * Copyright (C) 2000, 2004 by Martin Pool &lt;mbp sourcefrog net&gt;
+ *
+ * This software is provided 'as-is', without any express or implied warranty.
+ * In no event will the authors be held liable for any damages arising from the
+ * use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * @param ai            start of first character range to compare
+ * @param ae            end of first character range
+ * @param bi            start of second character range to compare
+ * @param be            end of second character range
+ * @param fold_case     ignore alphabetic case in comparison
+ * @return              0 if (a == b), -1 if (a < b) and +1 if (a > b).
+ */
+static inline int natcmp_algorithm(const char* ai, const char* ae,
+                                   const char* bi, const char* be,
+                                   bool fold_case)
+{
+    while (ai != ae || bi != be)
+    {
+        natcmp_skip_equal(ai, ae, bi, be, fold_case);
+
+        // skip over leading spaces or zeros
+        while (ai != ae && natcmp_class(*ai) == natcmp_space)
+            ++ai;
+
+        while (bi != be && natcmp_class(*bi) == natcmp_space)
+            ++bi;
+
+        if (ai == ae || bi == be)
+            break;
+
+        // process run of digits
+        if (natcmp_class(*ai) == natcmp_digit && natcmp_class(*bi) == natcmp_digit)
+        {
+            if (*ai == '0' || *bi == '0') // fractional
+            {
+                // Compare two left-aligned numbers: the first to have a
+                // different value wins.
+
+                while (ai != ae && bi != be)
+                {
+                    bool da = (natcmp_class(*ai) == natcmp_digit);
+                    bool db = (natcmp_class(*bi) == natcmp_digit);
+
+                    if (!da && !db)
+                        break;
+                    else if (!da)
+                        return -1;
+                    else if (!db)
+                        return +1;
+                    else if (*ai < *bi)
+                        return -1;
+                    else if (*ai > *bi)
+                        return +1;
+
+                    ++ai; ++bi;
+                }
+
+                continue;
+            }
+            else
+            {
+                // The longest run of digits wins.  That aside, the
+                // greatest value wins, but we can't know that it will
+                // until we've scanned both numbers to know that they have
+                // the same magnitude, so we remember it in BIAS.
+
+                int bias = 0;
+
+                while (ai != ae && bi != be)
+                {
+                    bool da = (natcmp_class(*ai) == natcmp_digit);
+                    bool db = (natcmp_class(*bi) == natcmp_digit);
+
+                    if (!da && !db) {
+                        if (bias) return bias;
+                        else break;
+                    }
+                    else if (!da)
+                        return -1;
+                    else if (!db)
+                        return +1;
+                    else if (*ai < *bi) {
+                        if (!bias) bias = -1;
+                    }
+                    else if (*ai > *bi) {
+                        if (!bias) bias = +1;
+                    }
+
+                    ++ai; ++bi;
+                }
+
+                // check for the longer sequence of digits
+                if (ai == ae && bi != be && natcmp_class(*bi) == natcmp_digit) return -1;
+                if (bi == be && ai != ae && natcmp_class(*ai) == natcmp_digit) return +1;
+
+                if (bias) return bias;
+
+                continue;
+            }
+        }
+
+        int ca = natcmp_value(*ai, fold_case);
+        int cb = natcmp_value(*bi, fold_case);
+
+        if (ca < cb)
+            return -1;
+        else if (ca > cb)
+            return +1;
+
+        ++ai; ++bi;
+    }
+
+    if (ai == ae && bi == be) {
+        // The strings compare the same.  Perhaps the caller will want to
+        // call strcmp to break the tie.
+        return 0;
+    }
+    else if (ai == ae && bi != be)
+        return -1;
+    else if (ai != ae && bi == be)
+        return +1;
+
+    return 0; // never reached
+}
+
+/**
+ * Function to compare two STL (binary) strings using the 'natural order'
+ * comparison algorithm, see above.
+ *
+ * @param a             first string to compare
+ * @param b             second string to compare
+ * @param fold_case     ignore alphabetic case in comparison
+ * @return              0 if (a == b), -1 if (a < b) and +1 if (a > b).
+ */
+static inline int natcmp_algorithm(const std::string& a, const std::string& b, bool fold_case)
+{
+    return natcmp_algorithm(a.data(), a.data() + a.size(),
+                            b.data(), b.data() + b.size(), fold_case);
+}
+
+// *** static inline std::string wrapper functions ***
+
+/**
+ * Function to compare two STL (binary) strings using the 'natural order'
+ * comparison algorithm. It orders strings so that "rfc1.txt" < "rfc822.txt" <
+ * "rfc2086.txt". The comparison is done case-sensitive.
+ *
+ * @param a     first string to compare
+ * @param b     second string to compare
+ * @return      0 if (a == b), -1 if (a < b) and +1 if (a > b).
+ */
+static inline int natcmp(const std::string& a, const std::string& b)
+{
+    return natcmp_algorithm(a, b, false);
 }
 
 /**
- * Dump a (binary) string into a C source code snippet. The snippet defines an
- * array of const char holding the data of the string. Cannot set a default
- * argument for varname, because it leads to ambiguous calls with the object
- * method below.
+ * Function to compare two STL (binary) strings using the 'natural order'
+ * comparison algorithm. It orders strings so that "rfc1.txt" < "rfc822.txt" <
+ * "rfc2086.txt". The comparison is done case-insensitive.
  *
- * @param str           string to output as C source array
- * @param varname       name of the array variable in the outputted code snippet
- * @return              string holding C source snippet
+ * @param a     first string to compare
+ * @param b     second string to compare
+ * @return      0 if (a == b), -1 if (a < b) and +1 if (a > b).
  */
-static inline std::string hexdump_sourcecode(const std::string& str, const std::string& varname)
+static inline int natcmp_icase(const std::string& a, const std::string& b)
 {
-    std::ostringstream header;
-    header << "const char " << varname << "[" << str.size() << "] = {\n";
-
-    static const int perline = 16;
-
-    std::string out = header.str();
-    out.reserve( out.size() + (str.size() * 5) - 1 + (str.size() / 16) + 4 );
-
-    static const char xdigits[16] = {
-        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-    };
-
-    std::string::size_type ci = 0;
-
-    for (std::string::const_iterator si = str.begin();
-         si != str.end(); ++si, ++ci)
-    {
-        out.append("0x");
-        out.append(1, xdigits[ (*si & 0xF0) >> 4 ]);
-        out.append(1, xdigits[ (*si & 0x0F) ]);
-
-        if (ci+1 < str.size()) {
-            out.append(1, ',');
-
-            if (ci % perline == perline-1) {
-                out.append(1, '\n');
-            }
-        }
-    }
+    return natcmp_algorithm(a, b, true);
+}
 
-    out.append("\n};\n");
+// *** natural order sort keys ***
 
-    return out;
+/**
+ * Map a (non-digit) character to the byte which represents it in a natural
+ * order sort key: natcmp_value() shifted down to 0..255.
+ */
+static inline unsigned char natsort_key_char(char c, bool fold_case)
+{
+    int base = fold_case ? 0 : CHAR_MIN;
+    return static_cast<unsigned char>(natcmp_value(c, fold_case) - base);
 }
 
-// ***                              ***
-// *** Base64 Encoding and Decoding ***
-// ***                              ***
-
 /**
- * Encode the given binary string into Base64 representation as described in
- * RFC 2045 or RFC 3548. The output string contains only characters
- * [A-Za-z0-9+/] and is roughly 33% longer than the input. The output string
- * can be broken into lines after n characters, where n must be a multiple of
- * 4. The function's code is based on code from the libb64 project (see
- * http://sourceforge.net/projects/libb64).
+ * Append a binary 'natural order' sort key of a string to key, see
+ * natsort_key().
  *
- * @param instr         input string to encode
- * @param linebreak     break the output string every n characters
- * @return              base64 encoded string
+ * @param key           output string to append the key to
+ * @param str           string to calculate the key of
+ * @param fold_case     ignore alphabetic case like natcmp_icase()
  */
-static inline std::string base64_encode(const std::string& instr, size_t linebreak = 0)
+static inline void natsort_key_append(std::string& key, const std::string& str,
+                                      bool fold_case)
 {
-    std::string::const_iterator inchar = instr.begin();
-    std::string outstr;
-
-    if (instr.size() == 0) return outstr;
+    // digit runs sort between characters smaller and larger than '0'..'9'.
+    // Runs with a leading zero are compared left-aligned (fractional) and
+    // always sort before integer runs, which are prefixed with their length.
+    const unsigned char frac_tag = natsort_key_char('0', fold_case);
+    const unsigned char int_tag = natsort_key_char('1', fold_case);
 
-    // calculate output string's size in advance
-    size_t outsize = (((instr.size() - 1) / 3) + 1) * 4;
-    if (linebreak > 0) outsize += outsize / linebreak;
-    outstr.reserve( outsize );
+    key.reserve(key.size() + str.size() + str.size() / 4 + 2);
 
-    static const char encoding64[65]
-        = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    char result = 0;
-    size_t linebegin = 0;
+    std::string::const_iterator si = str.begin();
 
-    while (1)
+    while (si != str.end())
     {
-        // step 0: if the string is finished here, no padding is needed
-        if (inchar == instr.end()) {
-            return outstr;
-        }
-
-        // step 0: process first byte, write first letter
-        char fragment = *inchar++;
-        result = (fragment & 0xFC) >> 2;
-        outstr += encoding64[static_cast<int>(result)];
-        result = (fragment & 0x03) << 4;
+        unsigned char cclass = natcmp_class(*si);
 
-        // step 1: if string finished here, add two padding '='s
-        if (inchar == instr.end()) {
-            outstr += encoding64[static_cast<int>(result)];
-            outstr += '=';
-            outstr += '=';
-            return outstr;
+        if (cclass == natcmp_space) {
+            ++si;
+            continue;
         }
 
-        // step 1: process second byte together with first, write second
-        // letter
-        fragment = *inchar++;
-        result |= (fragment & 0xF0) >> 4;
-        outstr += encoding64[static_cast<int>(result)];
-        result = (fragment & 0x0F) << 2;
-
-        // step 2: if string finished here, add one padding '='
-        if (inchar == instr.end()) {
-            outstr += encoding64[static_cast<int>(result)];
-            outstr += '=';
-            return outstr;
+        if (cclass != natcmp_digit) {
+            key += static_cast<char>(natsort_key_char(*si, fold_case));
+            ++si;
+            continue;
         }
 
-        // step 2: process third byte and write third and fourth letters.
-        fragment = *inchar++;
-
-        result |= (fragment & 0xC0) >> 6;
-        outstr += encoding64[static_cast<int>(result)];
-
-        result  = (fragment & 0x3F) >> 0;
-        outstr += encoding64[static_cast<int>(result)];
+        std::string::const_iterator di = si;
+        while (di != str.end() && natcmp_class(*di) == natcmp_digit) ++di;
 
-        // wrap base64 encoding into lines if desired, but only after whole
-        // blocks of 4 letters.
-        if (linebreak > 0 && outstr.size() - linebegin >= linebreak)
+        if (*si == '0')
         {
-            outstr += '\n';
-            linebegin = outstr.size();
+            // digits terminated by a zero byte, which is less than any digit
+            key += static_cast<char>(frac_tag);
+            key.append(si, di);
+            key += '\0';
+        }
+        else
+        {
+            // the longer run of digits wins, then the first different digit
+            size_t len = static_cast<size_t>(di - si);
+
+            key += static_cast<char>(int_tag);
+            if (len < 0xFF) {
+                key += static_cast<char>(len);
+            }
+            else {
+                key += static_cast<char>(0xFF);
+                for (int b = static_cast<int>(8 * sizeof(len)) - 8; b >= 0; b -= 8)
+                    key += static_cast<char>((len >> b) & 0xFF);
+            }
+            key.append(si, di);
         }
+
+        si = di;
     }
 }
 
 /**
- * Decode a stringin Base64 representation as described in RFC 2045 or RFC 3548
- * and return the original data. If a non-whitespace invalid Base64 character
- * is encountered _and_ the parameter "strict" is true, then this function will
- * throw a std::runtime_error. If "strict" is false, the character is silently
- * ignored. The function's code is based on code from the libb64 project (see
- * http://sourceforge.net/projects/libb64).
+ * Calculate a binary sort key for a string such that comparing two keys with
+ * memcmp() (or std::string's operator<) yields the same order as natcmp() or
+ * natcmp_icase() of the original strings, and equal keys mean natcmp() returns
+ * zero. The keys can be sorted with plain byte comparisons or radix sorts, or
+ * stored in indexes. To break ties like natless(), compare the original strings
+ * when the keys are equal.
  *
- * @param instr         input string to encode
- * @param strict        throw exception on invalid character
- * @return              decoded binary data
+ * @param str           string to calculate the key of
+ * @param fold_case     ignore alphabetic case like natcmp_icase()
+ * @return              binary sort key
  */
-static inline std::string base64_decode(const std::string& instr, bool strict = false)
+static inline std::string natsort_key(const std::string& str, bool fold_case = false)
 {
-    std::string::const_iterator inchar = instr.begin();
-    std::string outstr;
-
-    // estimate the output size, assume that the whole input string is
-    // base64 encoded.
-    outstr.reserve( instr.size() * 3 / 4 );
-
-    // value lookup table: -1 -> exception, -2 -> skip whitespace
-    const char decoding64[256] = {
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -2, -2, -1, -1, -2, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
-        52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -2, -1, -1,
-        -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
-        -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-    };
-
-    char outchar;
-    char fragment;
-
-    while (1)
-    {
-        // step 0: save first valid letter. do not output a byte, yet.
-        do {
-            if (inchar == instr.end()) return outstr;
-
-            fragment = decoding64[ static_cast<int>(*inchar++) ];
-
-            if (fragment == -1 && strict)
-                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+    std::string key;
+    natsort_key_append(key, str, fold_case);
+    return key;
+}
 
-        } while (fragment < 0);
+// *** std::string natural order comparison operators ***
 
-        outchar = (fragment & 0x3F) << 2;
+/**
+ * Compare two strings case-sensitively using the 'natural order'
+ * algorithm. Return true if they are equal.
+ */
+static inline bool natequal(const std::string& a, const std::string& b)
+{
+    return (natcmp(a, b) == 0);
+}
 
-        // step 1: get second valid letter. output the first byte.
-        do {
-            if (inchar == instr.end()) return outstr;
+/**
+ * Compare two strings case-insensitively using the 'natural order'
+ * algorithm. Return true if they are equal.
+ */
+static inline bool natequal_icase(const std::string& a, const std::string& b)
+{
+    return (natcmp_icase(a, b) == 0);
+}
 
-            fragment = decoding64[ static_cast<int>(*inchar++) ];
+/**
+ * Compare two string case-sensitively using the 'natural order'
+ * algorithm. Strings that are equal in the 'natural order' are compared using
+ * the binary less operator to break ties. Return true if this one is less than
+ * the other.
+ */
+static inline bool natless(const std::string& a, const std::string& b)
+{
+    int r = natcmp(a, b);
+    if (r != 0) return (r < 0);
+    return (a < b);
+}
 
-            if (fragment == -1 && strict)
-                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+/**
+ * Compare two string case-insensitively using the 'natural order'
+ * algorithm. Strings that are equal in the 'natural order' are compared using
+ * the binary less operator to break ties. Return true if this one is less than
+ * the other.
+ */
+static inline bool natless_icase(const std::string& a, const std::string& b)
+{
+    int r = natcmp_icase(a, b);
+    if (r != 0) return (r < 0);
+    return less_icase(a, b);
+}
 
-        } while (fragment < 0);
+// *** 'natural order' less-relation functional class for std::map and
+// *** others ***
 
-        outchar |= (fragment & 0x30) >> 4;
-        outstr += outchar;
+/**
+ * 'Natural order' case-sensitive less order relation functional class for
+ * std::map and others.
+ */
+struct order_natless {
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return natless(a, b);
+    }
+};
 
-        outchar = (fragment & 0x0F) << 4;
+/**
+ * 'Natural order' case-insensitive less order relation functional class
+ * for std::map and others.
+ */
+struct order_natless_icase {
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return natless_icase(a, b);
+    }
+};
 
-        // step 2: get third valid letter. output the second byte.
-        do {
-            if (inchar == instr.end())  return outstr;
+/**
+ * Descending 'natural order' case-sensitive less order relation
+ * functional class for std::map and others.
+ */
+struct order_natless_desc {
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return !natless(a, b);
+    }
+};
 
-            fragment = decoding64[ static_cast<int>(*inchar++) ];
+/**
+ * Descending 'natural order' case-insensitive less order relation
+ * functional class for std::map and others.
+ */
+struct order_natless_icase_desc {
+    inline bool operator()(const std::string &a, const std::string &b) const {
+        return !natless_icase(a, b);
+    }
+};
 
-            if (fragment == -1 && strict)
-                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+// *** Natural Order Sorting ***
 
-        } while (fragment < 0);
+/** Options for natsort(). */
+struct natsort_options
+{
+    //! ignore alphabetic case like natcmp_icase()
+    bool icase;
 
-        outchar |= (fragment & 0x3C) >> 2;
-        outstr += outchar;
+    //! sort into descending instead of ascending order
+    bool descending;
 
-        outchar = (fragment & 0x03) << 6;
+    //! keep strings which are equal in the 'natural order' in their original
+    //! order, instead of breaking ties by binary (or case-insensitive) order
+    bool stable;
 
-        // step 3: get fourth valid letter. output the third byte.
-        do {
-            if (inchar == instr.end()) return outstr;
+    //! number of threads, or zero for one per core. Ignored without C++11
+    //! threads.
+    unsigned int threads;
 
-            fragment = decoding64[ static_cast<int>(*inchar++) ];
+    natsort_options()
+        : icase(false), descending(false), stable(false), threads(0)
+    { }
+};
 
-            if (fragment == -1 && strict)
-                throw(std::runtime_error("Invalid character encountered during Base64 decoding."));
+/*
+ * Minimum number of strings per thread if natsort() chooses the number of
+ * threads itself.
+ */
+static const size_t natsort_min_chunk = 16 * 1024;
 
-        } while (fragment < 0);
+/** Sort key of one string in natsort(): reference to its key and position. */
+struct natsort_entry
+{
+    //! natsort_key() of the string
+    const char* key;
 
-        outchar |= (fragment & 0x3F);
-        outstr += outchar;
-    }
-}
+    //! length of key
+    size_t size;
 
-/*** URI Encoding and Decoding ************************************************/
+    //! original position of the string
+    size_t index;
+};
 
 /**
- * Decode a uri escaped string, mapping sequences like %0A to their original
- * character values. The transformation is done in-place.
- *
- * @param str		input string to decode
+ * Less order relation of natsort_entry. Equal keys are ordered by the
+ * original strings unless the sort is stable, and finally by their original
+ * position, such that no two entries are equal.
  */
-static inline void uri_decode_inplace(std::string& str)
+struct natsort_entry_less
 {
-    static const char hex2dec[256] =
-        {
-            /*       0  1  2  3   4  5  6  7   8  9  A  B   C  D  E  F */
-            /* 0 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 1 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 2 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 3 */  0, 1, 2, 3,  4, 5, 6, 7,  8, 9,-1,-1, -1,-1,-1,-1,
-
-            /* 4 */ -1,10,11,12, 13,14,15,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 5 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 6 */ -1,10,11,12, 13,14,15,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 7 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-
-            /* 8 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* 9 */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* A */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* B */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+    //! original strings
+    const std::vector<std::string>& strs;
 
-            /* C */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* D */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* E */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
-            /* F */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1
-        };
+    //! sort options
+    const natsort_options& opt;
 
-    char dec1, dec2;
-    size_t p = 0, q = 0;
+    natsort_entry_less(const std::vector<std::string>& s, const natsort_options& o)
+        : strs(s), opt(o)
+    { }
 
-    while (p < str.length())
+    inline bool operator()(const natsort_entry& a, const natsort_entry& b) const
     {
-        if (str[p] == '%' &&
-            p + 2 < str.length() &&
-            (dec1 = hex2dec[static_cast<int>(str[p+1])]) >= 0 &&
-            (dec2 = hex2dec[static_cast<int>(str[p+2])]) >= 0)
-        {
-            str[q++] = (dec1 << 4) + dec2;
-            p += 3;
-        }
-        else
-        {
-            str[q++] = str[p++];
+        int r = memcmp(a.key, b.key, std::min(a.size, b.size));
+        if (r == 0 && a.size != b.size)
+            r = (a.size < b.size) ? -1 : +1;
+
+        if (r == 0 && !opt.stable) {
+            const std::string& sa = strs[a.index], & sb = strs[b.index];
+            if (opt.icase)
+                r = less_icase(sa, sb) ? -1 : less_icase(sb, sa) ? +1 : 0;
+            else
+                r = sa.compare(sb);
         }
-    }
-    str.resize(q);
-}
-
-/*** Levenshtein String Distance **********************************************/
 
-// *** Parameter Struct and Algorithm ***
-
-/**
- * Standard parameters to levenshtein distance function. Costs are all 1 and
- * characters are compared directly.
- */
-struct LevenshteinStandard
-{
-    static const unsigned int cost_insert_delete        = 1;
-    static const unsigned int cost_replace              = 1;
+        if (r != 0)
+            return opt.descending ? (r > 0) : (r < 0);
 
-    static inline bool char_equal(const char& a, const char& b)
-    { return (a == b); }
+        return (a.index < b.index);
+    }
 };
 
+#if STX_STRING_THREADS
+
 /**
- * Standard parameters to Levenshtein distance function. Costs are all 1 and
- * characters are compared case-insensitively.
+ * Return the number of elements of [a,a+na) among the first d elements when
+ * merging it with [b,b+nb), with the merge path's binary search.
  */
-struct LevenshteinStandardICase
+template <typename Compare>
+static inline size_t natsort_corank(size_t d, const natsort_entry* a, size_t na,
+                                    const natsort_entry* b, size_t nb,
+                                    const Compare& less)
 {
-    static const unsigned int cost_insert_delete        = 1;
-    static const unsigned int cost_replace              = 1;
+    size_t lo = (d > nb) ? d - nb : 0, hi = std::min(d, na);
 
-    static inline bool char_equal(const char& a, const char& b)
-    { return std::tolower(a) == std::tolower(b); }
-};
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (less(a[mid], b[d - mid - 1]))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
 
 /**
- * Computes the Levenshtein string distance between two strings. The distance
- * is the minimum number of replacements/inserts/deletes needed to change one
- * string into the other. Implemented with time complexity O(|n|+|m|) and
- * memory complexity O(2*max(|n|,|m|))
- *
- * @param a     first string
- * @param b     second string
- * @return      Levenshtein distance
+ * Sort the entries concurrently: each thread sorts one chunk, then the
+ * chunks are merged pairwise in rounds, with each merge cut into pieces
+ * along its merge path so that all threads stay busy.
  */
-template <typename levenshtein_param>
-static inline size_t levenshtein_algorithm(const std::string& a, const std::string& b)
+template <typename Compare>
+static inline void natsort_parallel(std::vector<natsort_entry>& entries,
+                                    const Compare& less, unsigned int threads)
 {
-    // if one of the strings is zero, then all characters of the other must
-    // be inserted.
-    if (a.empty()) return b.size();
-    if (b.empty()) return a.size();
+    size_t n = entries.size();
 
-    // make "as" the longer string and "bs" the shorter.
-    const std::string &as = (a.size() > b.size()) ? a : b;
-    const std::string &bs = (a.size() > b.size()) ? b : a;
+    std::vector<size_t> bound(threads + 1);
+    for (unsigned int i = 0; i <= threads; ++i)
+        bound[i] = n / threads * i + std::min<size_t>(i, n % threads);
 
-    // only allocate two rows of the needed matrix.
-    std::vector<size_t> lastrow(as.size() + 1);
-    std::vector<size_t> thisrow(as.size() + 1);
+    split_parallel_run(threads, [&](unsigned int i) {
+        std::sort(entries.begin() + bound[i], entries.begin() + bound[i + 1], less);
+    });
 
-    // fill this row with ascending ordinals.
-    for(size_t i = 0; i < as.size() + 1; i++) {
-        thisrow[i] = i;
-    }
+    std::vector<natsort_entry> buffer(n);
 
-    // compute distance
-    for (size_t j = 1; j < bs.size() + 1; j++)
+    while (bound.size() > 2)
     {
-        // switch rows
-        std::swap(lastrow, thisrow);
+        const natsort_entry* src = entries.data();
+        natsort_entry* dst = buffer.data();
 
-        // compute new row
-        thisrow[0] = j;
+        // one task per piece of a merge of the runs [begin,mid) and
+        // [mid,end), writing size elements at output position d
+        struct task { size_t begin, mid, end, d, size; };
+        std::vector<task> tasks;
+        std::vector<size_t> next_bound(1, 0);
 
-        for(size_t i = 1; i < as.size() + 1; i++)
+        size_t runs = bound.size() - 1;
+        size_t pieces = std::max<size_t>(threads / (runs / 2), 1);
+
+        for (size_t r = 0; r < runs; r += 2)
         {
-            // three-way mimimum of
-            thisrow[i] = std::min(
-                std::min(
-                    // left plus insert cost
-                    thisrow[i-1] + levenshtein_param::cost_insert_delete,
-                    // top plus delete cost
-                    lastrow[i] + levenshtein_param::cost_insert_delete),
-                // top left plus replacement cost
-                lastrow[i-1] + (levenshtein_param::char_equal(as[i-1], bs[j-1]) ? 0 : levenshtein_param::cost_replace)
-                );
+            size_t begin = bound[r], mid = bound[r + 1];
+            size_t end = (r + 1 < runs) ? bound[r + 2] : mid;
+            size_t size = end - begin;
+
+            for (size_t p = 0; p < pieces; ++p) {
+                size_t d = size * p / pieces;
+                task t = { begin, mid, end, d, size * (p + 1) / pieces - d };
+                tasks.push_back(t);
+            }
+            next_bound.push_back(end);
         }
-    }
 
-    // result is in the last cell of the last computed row
-    return thisrow[ as.size() ];
+        split_parallel_run(static_cast<unsigned int>(tasks.size()), [&](unsigned int k) {
+            const task& t = tasks[k];
+            const natsort_entry* a = src + t.begin, * b = src + t.mid;
+            size_t na = t.mid - t.begin, nb = t.end - t.mid;
+
+            size_t i = natsort_corank(t.d, a, na, b, nb, less);
+            size_t j = natsort_corank(t.d + t.size, a, na, b, nb, less);
+
+            std::merge(a + i, a + j, b + (t.d - i), b + (t.d + t.size - j),
+                       dst + t.begin + t.d, less);
+        });
+
+        entries.swap(buffer);
+        bound.swap(next_bound);
+    }
 }
 
-// *** static inline Wrapper Functions ***
+#endif // STX_STRING_THREADS
 
 /**
- * Computes the Levenshtein string distance between two strings. The distance
- * is the minimum number of replacements/inserts/deletes needed to change one
- * string into the other.
+ * Sort a vector of strings into 'natural order'. The natsort_key() of each
+ * string is calculated once, the keys are sorted with binary comparisons,
+ * concurrently with C++11 threads, and finally the strings are permuted
+ * into place. Without the stable option the result is the same as
+ * std::sort() with order_natless or order_natless_icase.
  *
- * @param a     first string
- * @param b     second string
- * @return      Levenshtein distance
+ * @param v             vector of strings to sort
+ * @param opt           sort options
  */
-static inline size_t levenshtein(const std::string& a, const std::string& b)
+static inline void natsort(std::vector<std::string>& v,
+                           const natsort_options& opt = natsort_options())
 {
-    return levenshtein_algorithm<LevenshteinStandard>(a, b);
+    size_t n = v.size();
+    if (n <= 1) return;
+
+    unsigned int threads = 1;
+#if STX_STRING_THREADS
+    threads = opt.threads;
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+        threads = static_cast<unsigned int>(
+            std::min<size_t>(threads, n / natsort_min_chunk + 1));
+    }
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, n));
+#endif
+
+    std::vector<std::string> keys(n);
+    std::vector<natsort_entry> entries(n);
+
+    natsort_entry_less less(v, opt);
+
+    if (threads <= 1)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            natsort_key_append(keys[i], v[i], opt.icase);
+            natsort_entry e = { keys[i].data(), keys[i].size(), i };
+            entries[i] = e;
+        }
+
+        std::sort(entries.begin(), entries.end(), less);
+    }
+#if STX_STRING_THREADS
+    else
+    {
+        split_parallel_run(threads, [&](unsigned int t) {
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+                natsort_key_append(keys[i], v[i], opt.icase);
+                natsort_entry e = { keys[i].data(), keys[i].size(), i };
+                entries[i] = e;
+            }
+        });
+
+        natsort_parallel(entries, less, threads);
+    }
+#endif
+
+    // apply the permutation
+    std::vector<std::string> sorted(n);
+    for (size_t i = 0; i < n; ++i)
+        sorted[i].swap(v[entries[i].index]);
+    v.swap(sorted);
 }
 
 /**
- * Computes the Levenshtein string distance between two strings. The distance
- * is the minimum number of replacements/inserts/deletes needed to change one
- * string into the other. Character comparison is done case-insensitively.
+ * Sort a vector of strings into case-insensitive 'natural order', see
+ * natsort().
  *
- * @param a     first string
- * @param b     second string
- * @return      Levenshtein distance
+ * @param v             vector of strings to sort
+ * @param opt           sort options, icase is set implicitly
  */
-static inline size_t levenshtein_icase(const std::string& a, const std::string& b)
+static inline void natsort_icase(std::vector<std::string>& v,
+                                 natsort_options opt = natsort_options())
 {
-    return levenshtein_algorithm<LevenshteinStandardICase>(a, b);
+    opt.icase = true;
+    natsort(v, opt);
 }
 
-// ***                            ***
-// *** 'Natural Order' Comparison ***
-// ***                            ***
-
-// *** Algorithm and Helper Functions ***
+// ***                               ***
+// *** Front-Coded String Dictionary ***
+// ***                               ***
 
 /**
- * Function to compare two STL (binary) strings using the 'natural order'
- * comparison algorithm written by Martin Pool. I converted the C code using
- * C-style strings to STL-style string processing. The equivalence to the
- * original algorithm is verified in the test suite.
- *
- * Based on:
- *
- * strnatcmp.c -- Perform 'natural order' comparisons of strings in C.
- * Copyright (C) 2000, 2004 by Martin Pool &lt;mbp sourcefrog net&gt;
- *
- * This software is provided 'as-is', without any express or implied warranty.
- * In no event will the authors be held liable for any damages arising from the
- * use of this software.
+ * Compact immutable dictionary of sorted, unique strings, which are
+ * front-coded in blocks: the first string of each block is stored in full
+ * and serves as sampled index for binary search, each further string only
+ * as the length of the prefix it shares with its predecessor plus the
+ * remaining suffix. The strings are ordered by bytes, by natless() or by
+ * natless_icase().
  *
- * Permission is granted to anyone to use this software for any purpose,
- * including commercial applications, and to alter it and redistribute it
- * freely, subject to the following restrictions:
+ * build() serializes a dictionary into an image, which string_dict then
+ * references without any parsing, hence an image written to a file can be
+ * mapped into memory (e.g. with mapped_file) and used immediately. The
+ * referenced image must outlive the dictionary. Image layout, with all
+ * integers little-endian:
  *
- * 1. The origin of this software must not be misrepresented; you must not
- *    claim that you wrote the original software. If you use this software
- *    in a product, an acknowledgment in the product documentation would be
- *    appreciated but is not required.
- * 2. Altered source versions must be plainly marked as such, and must not be
- *    misrepresented as being the original software.
- * 3. This notice may not be removed or altered from any source distribution.
+ *   offset  size           field
+ *   0       8              magic "stxdict1"
+ *   8       4              order (order_type)
+ *   12      4              block size: strings per block
+ *   16      8              number of strings
+ *   24      8              number of blocks
+ *   32      8 * blocks+8   offset of each block and of the end in the data
+ *   ...                    data: the blocks
  *
- * @param a             first string to compare
- * @param b             second string to compare
- * @param fold_case     ignore alphabetic case in comparison
- * @return              0 if (a == b), -1 if (a < b) and +1 if (a > b).
+ * In a block, the first string is stored as varint length plus characters,
+ * each further one as varint common prefix length, varint suffix length and
+ * the suffix characters. Varints are LEB128 encoded.
  */
-static inline int natcmp_algorithm(const std::string& a, const std::string& b, bool fold_case)
+class string_dict
 {
-    std::string::const_iterator ai = a.begin();
-    std::string::const_iterator bi = b.begin();
+public:
+    typedef std::string::size_type size_type;
+
+    //! order of the strings in a dictionary
+    enum order_type {
+        //! binary order of std::string's operator<
+        order_binary = 0,
+        //! 'natural order' of natless()
+        order_natural = 1,
+        //! case-insensitive 'natural order' of natless_icase()
+        order_natural_icase = 2
+    };
+
+    /**
+     * Forward iterator over the strings of a dictionary, which decodes them
+     * sequentially. Dereferencing returns a reference to the decoded string,
+     * which is valid until the iterator is advanced.
+     */
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::string value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::string* pointer;
+        typedef const std::string& reference;
+
+        const_iterator()
+            : m_dict(NULL), m_index(0), m_pos(NULL)
+        { }
+
+        const std::string& operator * () const { return m_str; }
+
+        const std::string* operator -> () const { return &m_str; }
+
+        const_iterator& operator ++ ()
+        {
+            if (++m_index < m_dict->m_count) load();
+            else m_str.clear();
+            return *this;
+        }
+
+        const_iterator operator ++ (int)
+        { const_iterator tmp = *this; ++*this; return tmp; }
+
+        //! position of the current string in the dictionary
+        size_type index() const { return m_index; }
+
+        bool operator == (const const_iterator& other) const
+        { return m_index == other.m_index; }
+
+        bool operator != (const const_iterator& other) const
+        { return m_index != other.m_index; }
+
+    private:
+        friend class string_dict;
+
+        //! construct an iterator at the start of a block
+        const_iterator(const string_dict* dict, size_type block)
+            : m_dict(dict), m_index(block * dict->m_block_size), m_pos(NULL)
+        {
+            if (m_index < dict->m_count) {
+                m_pos = dict->m_area + dict->block_offset(block);
+                load();
+            }
+            else {
+                m_index = dict->m_count;
+            }
+        }
+
+        //! decode the string at m_index from m_pos
+        void load()
+        {
+            if (m_index % m_dict->m_block_size == 0) {
+                size_type size = get_varint(m_pos);
+                m_str.assign(m_pos, size);
+                m_pos += size;
+            }
+            else {
+                size_type prefix = get_varint(m_pos);
+                size_type size = get_varint(m_pos);
+                m_str.resize(prefix);
+                m_str.append(m_pos, size);
+                m_pos += size;
+            }
+        }
+
+        //! dictionary iterated over
+        const string_dict* m_dict;
+
+        //! index of the current string
+        size_type m_index;
+
+        //! position of the next encoded string
+        const char* m_pos;
+
+        //! current decoded string
+        std::string m_str;
+    };
+
+    typedef const_iterator iterator;
 
-    while (ai != a.end() || bi != b.end())
+    friend class const_iterator;
+
+    //! construct an empty dictionary
+    string_dict()
+        : m_order(order_binary), m_block_size(1), m_count(0), m_blocks(0),
+          m_offsets(NULL), m_area(NULL)
+    { }
+
+    /**
+     * Construct a dictionary referencing an image created by build(). Only
+     * the header is checked, throws std::runtime_error if it is invalid.
+     *
+     * @param data      start of the image
+     * @param size      size of the image
+     */
+    string_dict(const char* data, size_type size)
     {
-        // skip over leading spaces or zeros
-        while (ai != a.end() && std::isspace(*ai))
-            ++ai;
+        static const char* error = "string_dict: invalid dictionary image";
 
-        while (bi != b.end() && std::isspace(*bi))
-            ++bi;
+        if (size < header_size || memcmp(data, "stxdict1", 8) != 0)
+            throw(std::runtime_error(error));
 
-        if (ai == a.end() || bi == b.end())
-            break;
+        unsigned long long order = get_le(data + 8, 4);
+        m_block_size = static_cast<size_type>(get_le(data + 12, 4));
+        m_count = static_cast<size_type>(get_le(data + 16, 8));
+        m_blocks = static_cast<size_type>(get_le(data + 24, 8));
 
-        // process run of digits
-        if (std::isdigit(*ai) && std::isdigit(*bi))
+        if (order > order_natural_icase || m_block_size == 0 ||
+            m_blocks != m_count / m_block_size + (m_count % m_block_size != 0) ||
+            (size - header_size) / 8 <= m_blocks)
+            throw(std::runtime_error(error));
+
+        m_order = static_cast<order_type>(order);
+
+        m_offsets = data + header_size;
+        m_area = m_offsets + 8 * (m_blocks + 1);
+
+        if (block_offset(m_blocks) != size - static_cast<size_type>(m_area - data))
+            throw(std::runtime_error(error));
+    }
+
+    /**
+     * Serialize sorted, unique strings into a dictionary image. Throws
+     * std::runtime_error if the strings are not strictly ascending in the
+     * given order.
+     *
+     * @param begin         iterator to the first string
+     * @param end           iterator beyond the last string
+     * @param order         order of the strings
+     * @param block_size    number of strings per front-coded block
+     * @return              dictionary image
+     */
+    template <typename Iterator>
+    static std::string build(Iterator begin, Iterator end,
+                             order_type order = order_binary,
+                             unsigned int block_size = 16)
+    {
+        if (block_size == 0)
+            throw(std::runtime_error("string_dict::build() block size is zero"));
+
+        std::string data;
+        std::vector<size_type> offsets;
+        std::string prev;
+        size_type count = 0;
+
+        for ( ; begin != end; ++begin, ++count)
         {
-            if (*ai == '0' || *bi == '0') // fractional
-            {
-                // Compare two left-aligned numbers: the first to have a
-                // different value wins.
+            string_ref str(*begin);
 
-                while (ai != a.end() && bi != b.end())
-                {
-                    if (!std::isdigit(*ai) && !std::isdigit(*bi))
-                        break;
-                    else if (!std::isdigit(*ai))
-                        return -1;
-                    else if (!std::isdigit(*bi))
-                        return +1;
-                    else if (*ai < *bi)
-                        return -1;
-                    else if (*ai > *bi)
-                        return +1;
+            if (count != 0 && compare(order, prev, str) >= 0)
+                throw(std::runtime_error("string_dict::build() strings are not sorted and unique"));
 
-                    ++ai; ++bi;
-                }
+            if (count % block_size == 0) {
+                offsets.push_back(data.size());
+                put_varint(data, str.size());
+                data.append(str.data(), str.size());
+            }
+            else {
+                size_type prefix = string_sort_mismatch<false>(
+                    prev.data(), str.data(), std::min(prev.size(), str.size()));
 
-                continue;
+                put_varint(data, prefix);
+                put_varint(data, str.size() - prefix);
+                data.append(str.data() + prefix, str.size() - prefix);
             }
+
+            prev.assign(str.data(), str.size());
+        }
+        offsets.push_back(data.size());
+
+        std::string image("stxdict1", 8);
+        put_le(image, order, 4);
+        put_le(image, block_size, 4);
+        put_le(image, count, 8);
+        put_le(image, offsets.size() - 1, 8);
+        for (size_t i = 0; i < offsets.size(); ++i)
+            put_le(image, offsets[i], 8);
+
+        return image + data;
+    }
+
+    //! number of strings in the dictionary
+    size_type size() const { return m_count; }
+
+    //! true if the dictionary contains no strings
+    bool empty() const { return (m_count == 0); }
+
+    //! order of the strings
+    order_type order() const { return m_order; }
+
+    //! iterator to the first string
+    const_iterator begin() const { return const_iterator(this, 0); }
+
+    //! past-the-end iterator
+    const_iterator end() const { return const_iterator(this, m_blocks); }
+
+    //! return an iterator to the i-th string, decoding its block up to it
+    const_iterator iterator_at(size_type i) const
+    {
+        if (i >= m_count) return end();
+
+        const_iterator it(this, i / m_block_size);
+        while (it.m_index < i) ++it;
+        return it;
+    }
+
+    //! return a copy of the i-th string
+    std::string operator [] (size_type i) const
+    {
+        return *iterator_at(i);
+    }
+
+    /**
+     * Return an iterator to the first string which is not less than key in
+     * the dictionary's order. Binary searches the first strings of the
+     * blocks, then decodes one block.
+     */
+    const_iterator lower_bound(const string_ref& key) const
+    {
+        // find the last block whose first string is not greater than key
+        size_type lo = 0, hi = m_blocks;
+        while (lo < hi)
+        {
+            size_type mid = lo + (hi - lo) / 2;
+            if (compare(block_first(mid), key) <= 0)
+                lo = mid + 1;
             else
-            {
-                // The longest run of digits wins.  That aside, the
-                // greatest value wins, but we can't know that it will
-                // until we've scanned both numbers to know that they have
-                // the same magnitude, so we remember it in BIAS.
+                hi = mid;
+        }
 
-                int bias = 0;
+        if (lo == 0) return begin();
 
-                while(ai != a.end() && bi != b.end())
-                {
-                    if (!std::isdigit(*ai) && !std::isdigit(*bi)) {
-                        if (bias) return bias;
-                        else break;
-                    }
-                    else if (!std::isdigit(*ai))
-                        return -1;
-                    else if (!std::isdigit(*bi))
-                        return +1;
-                    else if (*ai < *bi) {
-                        if (!bias) bias = -1;
-                    }
-                    else if (*ai > *bi) {
-                        if (!bias) bias = +1;
-                    }
+        const_iterator it(this, lo - 1);
+        for (size_type n = 0; n < m_block_size && it.m_index < m_count; ++n, ++it)
+        {
+            if (compare(*it, key) >= 0) return it;
+        }
+        return it;
+    }
 
-                    ++ai; ++bi;
-                }
+    //! return an iterator to the string equivalent to key, or end()
+    const_iterator find(const string_ref& key) const
+    {
+        const_iterator it = lower_bound(key);
+        if (it != end() && compare(*it, key) == 0) return it;
+        return end();
+    }
 
-                // check for the longer sequence of digits
-                if (ai == a.end() && bi != b.end() && std::isdigit(*bi)) return -1;
-                if (bi == b.end() && ai != a.end() && std::isdigit(*ai)) return +1;
+    //! true if the dictionary contains a string equivalent to key
+    bool contains(const string_ref& key) const
+    {
+        return find(key) != end();
+    }
 
-                if (bias) return bias;
+    /**
+     * Return the range of strings starting with prefix. Throws
+     * std::runtime_error unless the dictionary is in binary order, since only
+     * then are they adjacent.
+     */
+    std::pair<const_iterator, const_iterator> prefix_range(const string_ref& prefix) const
+    {
+        if (m_order != order_binary)
+            throw(std::runtime_error("string_dict::prefix_range() requires binary order"));
 
-                continue;
-            }
+        // the smallest string greater than all strings with the prefix
+        std::string upper = prefix.str();
+        while (!upper.empty() && static_cast<unsigned char>(upper[upper.size() - 1]) == 0xFF)
+            upper.resize(upper.size() - 1);
+
+        const_iterator first = lower_bound(prefix);
+        if (upper.empty())
+            return std::make_pair(first, end());
+
+        upper[upper.size() - 1] = static_cast<char>(upper[upper.size() - 1] + 1);
+        return std::make_pair(first, lower_bound(upper));
+    }
+
+    //! three-way comparison of two strings in the dictionary's order
+    int compare(const string_ref& a, const string_ref& b) const
+    {
+        return compare(m_order, a, b);
+    }
+
+    //! three-way comparison of two strings in the given order
+    static int compare(order_type order, const string_ref& a, const string_ref& b)
+    {
+        int r = 0;
+
+        if (order != order_binary) {
+            r = natcmp_algorithm(a.begin(), a.end(), b.begin(), b.end(),
+                                 order == order_natural_icase);
+            if (r != 0) return r;
         }
 
-        int ca = fold_case ? std::toupper(*ai) : *ai;
-        int cb = fold_case ? std::toupper(*bi) : *bi;
+        if (order != order_natural_icase)
+            return a.compare(b);
 
-        if (ca < cb)
-            return -1;
-        else if (ca > cb)
-            return +1;
+        r = memcmp_icase(a.data(), b.data(), std::min(a.size(), b.size()));
+        if (r != 0) return r;
+        return (a.size() < b.size()) ? -1 : (a.size() > b.size()) ? +1 : 0;
+    }
 
-        ++ai; ++bi;
+private:
+    //! size of the fixed image header
+    static const size_type header_size = 32;
+
+    //! offset of a block in the data area
+    size_type block_offset(size_type block) const
+    {
+        return static_cast<size_type>(get_le(m_offsets + 8 * block, 8));
     }
 
-    if (ai == a.end() && bi == b.end()) {
-        // The strings compare the same.  Perhaps the caller will want to
-        // call strcmp to break the tie.
-        return 0;
+    //! reference to the first string of a block
+    string_ref block_first(size_type block) const
+    {
+        const char* p = m_area + block_offset(block);
+        size_type size = get_varint(p);
+        return string_ref(p, size);
     }
-    else if (ai == a.end() && bi != b.end())
-        return -1;
-    else if (ai != a.end() && bi == b.end())
-        return +1;
 
-    return 0; // never reached
-}
+    //! read a little-endian integer of the given number of bytes
+    static unsigned long long get_le(const char* p, unsigned int bytes)
+    {
+        unsigned long long v = 0;
+        for (unsigned int i = 0; i < bytes; ++i)
+            v |= static_cast<unsigned long long>(static_cast<unsigned char>(p[i])) << (8 * i);
+        return v;
+    }
 
-// *** static inline std::string wrapper functions ***
+    //! append a little-endian integer of the given number of bytes
+    static void put_le(std::string& out, unsigned long long v, unsigned int bytes)
+    {
+        for (unsigned int i = 0; i < bytes; ++i)
+            out += static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
 
-/**
- * Function to compare two STL (binary) strings using the 'natural order'
- * comparison algorithm. It orders strings so that "rfc1.txt" < "rfc822.txt" <
- * "rfc2086.txt". The comparison is done case-sensitive.
- *
- * @param a     first string to compare
- * @param b     second string to compare
- * @return      0 if (a == b), -1 if (a < b) and +1 if (a > b).
- */
-static inline int natcmp(const std::string& a, const std::string& b)
-{
-    return natcmp_algorithm(a, b, false);
-}
+    //! read a LEB128 varint and advance p
+    static size_type get_varint(const char*& p)
+    {
+        size_type v = 0;
+        for (unsigned int shift = 0; ; shift += 7)
+        {
+            unsigned char c = static_cast<unsigned char>(*p++);
+            v |= static_cast<size_type>(c & 0x7F) << shift;
+            if (!(c & 0x80)) return v;
+        }
+    }
 
-/**
- * Function to compare two STL (binary) strings using the 'natural order'
- * comparison algorithm. It orders strings so that "rfc1.txt" < "rfc822.txt" <
- * "rfc2086.txt". The comparison is done case-insensitive.
- *
- * @param a     first string to compare
- * @param b     second string to compare
- * @return      0 if (a == b), -1 if (a < b) and +1 if (a > b).
- */
-static inline int natcmp_icase(const std::string& a, const std::string& b)
-{
-    return natcmp_algorithm(a, b, true);
-}
+    //! append a LEB128 varint
+    static void put_varint(std::string& out, size_type v)
+    {
+        while (v >= 0x80) {
+            out += static_cast<char>((v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        out += static_cast<char>(v);
+    }
 
-// *** std::string natural order comparison operators ***
+    //! order of the strings
+    order_type m_order;
 
-/**
- * Compare two strings case-sensitively using the 'natural order'
- * algorithm. Return true if they are equal.
- */
-static inline bool natequal(const std::string& a, const std::string& b)
-{
-    return (natcmp(a, b) == 0);
-}
+    //! number of strings per block
+    size_type m_block_size;
 
-/**
- * Compare two strings case-insensitively using the 'natural order'
- * algorithm. Return true if they are equal.
- */
-static inline bool natequal_icase(const std::string& a, const std::string& b)
-{
-    return (natcmp_icase(a, b) == 0);
-}
+    //! number of strings
+    size_type m_count;
 
-/**
- * Compare two string case-sensitively using the 'natural order'
- * algorithm. Strings that are equal in the 'natural order' are compared using
- * the binary less operator to break ties. Return true if this one is less than
- * the other.
- */
-static inline bool natless(const std::string& a, const std::string& b)
-{
-    int r = natcmp(a, b);
-    if (r != 0) return (r < 0);
-    return (a < b);
-}
+    //! number of blocks
+    size_type m_blocks;
+
+    //! block offset array in the image
+    const char* m_offsets;
+
+    //! data area with the blocks in the image
+    const char* m_area;
+};
+
+} // namespace string
+} // namespace stx
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// ***                                                         ***
+// *** File Descriptor Streaming Record Reader and Mapped File ***
+// ***                                                         ***
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace stx {
+namespace string {
 
 /**
- * Compare two string case-insensitively using the 'natural order'
- * algorithm. Strings that are equal in the 'natural order' are compared using
- * the binary less operator to break ties. Return true if this one is less than
- * the other.
+ * Record source reading from a POSIX file descriptor, for use with
+ * basic_record_reader. Throws std::runtime_error if read() fails.
  */
-static inline bool natless_icase(const std::string& a, const std::string& b)
+class fd_record_source
 {
-    int r = natcmp_icase(a, b);
-    if (r != 0) return (r < 0);
-    return less_icase(a, b);
-}
+public:
+    explicit fd_record_source(int fd)
+        : m_fd(fd)
+    { }
 
-// *** 'natural order' less-relation functional class for std::map and
-// *** others ***
+    //! read up to size bytes into data, returns zero at end of file
+    std::string::size_type read(char* data, std::string::size_type size)
+    {
+        while (true)
+        {
+            ssize_t rb = ::read(m_fd, data, size);
+            if (rb >= 0) return static_cast<std::string::size_type>(rb);
+            if (errno == EINTR) continue;
 
-/**
- * 'Natural order' case-sensitive less order relation functional class for
- * std::map and others.
- */
-struct order_natless {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return natless(a, b);
+            std::ostringstream oss;
+            oss << "Error reading records from file descriptor: " << strerror(errno);
+            throw(std::runtime_error(oss.str()));
+        }
     }
+
+private:
+    //! file descriptor to read from
+    int m_fd;
 };
 
+/** Streaming record reader over a POSIX file descriptor. */
+typedef basic_record_reader<fd_record_source> fd_record_reader;
+
 /**
- * 'Natural order' case-insensitive less order relation functional class
- * for std::map and others.
+ * Read-only memory mapping of a whole file, e.g. of a string_dict image,
+ * which is unmapped on destruction. Throws std::runtime_error if the file
+ * cannot be opened or mapped.
  */
-struct order_natless_icase {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return natless_icase(a, b);
+class mapped_file
+{
+public:
+    //! map the file with the given path
+    explicit mapped_file(const std::string& path)
+        : m_data(NULL), m_size(0)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) error("Error opening file " + path);
+
+        try {
+            map(fd);
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
     }
-};
 
-/**
- * Descending 'natural order' case-sensitive less order relation
- * functional class for std::map and others.
- */
-struct order_natless_desc {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return !natless(a, b);
+    //! map the file open at the given file descriptor, which is not closed
+    explicit mapped_file(int fd)
+        : m_data(NULL), m_size(0)
+    {
+        map(fd);
     }
-};
 
-/**
- * Descending 'natural order' case-insensitive less order relation
- * functional class for std::map and others.
- */
-struct order_natless_icase_desc {
-    inline bool operator()(const std::string &a, const std::string &b) const {
-        return !natless_icase(a, b);
+    ~mapped_file()
+    {
+        if (m_data) ::munmap(m_data, m_size);
+    }
+
+    //! pointer to the first byte of the file
+    const char* data() const { return static_cast<const char*>(m_data); }
+
+    //! size of the file
+    std::string::size_type size() const { return m_size; }
+
+private:
+    //! map the whole file open at fd, empty files are not mapped
+    void map(int fd)
+    {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) error("Error getting file size");
+
+        m_size = static_cast<std::string::size_type>(st.st_size);
+        if (m_size == 0) return;
+
+        void* p = ::mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) error("Error mapping file");
+        m_data = p;
+    }
+
+    //! throw std::runtime_error with message and errno's description
+    static void error(const std::string& msg)
+    {
+        std::ostringstream oss;
+        oss << msg << ": " << strerror(errno);
+        throw(std::runtime_error(oss.str()));
     }
+
+    //! non-copyable
+    mapped_file(const mapped_file&);
+
+    //! non-assignable
+    mapped_file& operator = (const mapped_file&);
+
+    //! start of the mapping, or NULL for empty files
+    void* m_data;
+
+    //! size of the mapping
+    std::string::size_type m_size;
 };
 
 } // namespace string
 } // namespace stx
 
+#endif // defined(__unix__) || defined(__APPLE__)
+
 #if HAVE_ZLIB
 
 // ***                                              ***
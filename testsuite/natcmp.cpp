@@ -33,10 +33,50 @@
 #include "strnatcmp.h"
 #include "check.h"
 
+static int sign(int r)
+{
+    return (r > 0) - (r < 0);
+}
+
 void test_static()
 {
     CHECK( stx::string::natcmp("120g9el", "99") == 1 );
     CHECK( stx::string::natcmp("8", "665J319048") == -1 );
+
+    // long equal prefixes are skipped word-wise, but not into digit runs
+    CHECK( stx::string::natcmp("/usr/share/doc/pkg/rfc822.txt",
+                               "/usr/share/doc/pkg/rfc2086.txt") == -1 );
+    CHECK( stx::string::natcmp("/usr/share/doc/pkg-12345/a",
+                               "/usr/share/doc/pkg-1234x/a") == +1 );
+    CHECK( stx::string::natcmp("/usr/share/doc/pkg-0123/a",
+                               "/usr/share/doc/pkg-012/a") == +1 );
+    CHECK( stx::string::natcmp("/USR/share/DOC/pkg-7/A",
+                               "/usr/SHARE/doc/PKG-10/a") == -1 );
+    CHECK( stx::string::natcmp_icase("/USR/share/DOC/pkg-10/A",
+                                     "/usr/SHARE/doc/PKG-7/a") == +1 );
+    CHECK( stx::string::natcmp_icase("/USR/share/DOC/pkg 10/A",
+                                     "/usr/SHARE/doc/PKG10/a") == 0 );
+}
+
+void test_natsort_key()
+{
+    using stx::string::natsort_key;
+
+    CHECK( natsort_key("rfc1.txt") < natsort_key("rfc822.txt") );
+    CHECK( natsort_key("rfc822.txt") < natsort_key("rfc2086.txt") );
+    CHECK( natsort_key("x05") < natsort_key("x1") );
+    CHECK( natsort_key("x05") < natsort_key("x051") );
+    CHECK( natsort_key(" a 12") == natsort_key("a12 ") );
+    CHECK( natsort_key("RFC2.txt") < natsort_key("rfc1.txt") );
+    CHECK( natsort_key("RFC2.txt", true) > natsort_key("rfc1.txt", true) );
+
+    // digit runs longer than a single length byte
+    std::string n1 = "a" + std::string(300, '7');
+    std::string n2 = "a" + std::string(301, '1');
+    std::string n3 = "a" + std::string(254, '9');
+    CHECK( stx::string::natcmp(n1, n2) == -1 );
+    CHECK( natsort_key(n1) < natsort_key(n2) );
+    CHECK( natsort_key(n3) < natsort_key(n1) );
 }
 
 void test_random()
@@ -63,6 +103,10 @@ void test_random()
             }
 
             CHECK( r1 == r2 );
+
+            int r3 = sign( stx::string::natsort_key(sa).compare(
+                               stx::string::natsort_key(sb)) );
+            CHECK( r3 == r2 );
         }
         {
             int r1 = stx::string::natcmp_icase(sa, sb);
@@ -75,6 +119,10 @@ void test_random()
             }
 
             CHECK( r1 == r2 );
+
+            int r3 = sign( stx::string::natsort_key(sa, true).compare(
+                               stx::string::natsort_key(sb, true)) );
+            CHECK( r3 == r2 );
         }
     }
 }
@@ -107,11 +155,63 @@ void test_map()
     CHECK( j == natset_icase.end() );
 }
 
+static bool natcmp_icase_less(const std::string& a, const std::string& b)
+{
+    return stx::string::natcmp_icase(a, b) < 0;
+}
+
+static bool natcmp_greater(const std::string& a, const std::string& b)
+{
+    return stx::string::natcmp(a, b) > 0;
+}
+
+void test_natsort()
+{
+    static const char* cset = "aAbB0123456789 ";
+
+    for (unsigned int threads = 0; threads <= 5; ++threads)
+    {
+        std::vector<std::string> v(threads * 997 + 3);
+        for (size_t i = 0; i < v.size(); ++i)
+            v[i] = stx::string::random(rand() % 6, cset);
+
+        stx::string::natsort_options opt;
+        opt.threads = threads;
+
+        std::vector<std::string> s1 = v, s2 = v;
+        stx::string::natsort(s1, opt);
+        std::sort(s2.begin(), s2.end(), stx::string::order_natless());
+        CHECK( s1 == s2 );
+
+        s1 = v, s2 = v;
+        stx::string::natsort_icase(s1, opt);
+        std::sort(s2.begin(), s2.end(), stx::string::order_natless_icase());
+        for (size_t i = 0; i < s1.size(); ++i)
+            CHECK( stx::string::equal_icase(s1[i], s2[i]) );
+
+        opt.stable = true;
+
+        s1 = v, s2 = v;
+        stx::string::natsort_icase(s1, opt);
+        std::stable_sort(s2.begin(), s2.end(), natcmp_icase_less);
+        CHECK( s1 == s2 );
+
+        opt.descending = true;
+
+        s1 = v, s2 = v;
+        stx::string::natsort(s1, opt);
+        std::stable_sort(s2.begin(), s2.end(), natcmp_greater);
+        CHECK( s1 == s2 );
+    }
+}
+
 int main()
 {
     test_static();
+    test_natsort_key();
     test_random();
     test_map();
+    test_natsort();
 
     return 0;
 }
@@ -29,7 +29,14 @@
 
 #include <stx-string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <time.h>
+#include <map>
+#include <set>
+
+#if __cplusplus >= 201103L
+#include <unordered_map>
+#endif
 
 #include "check.h"
 
@@ -75,6 +82,33 @@ void test_trim()
     CHECK( stx::string::trim_inplace(str2) == "abc" );
     CHECK( stx::string::trim_inplace(str3) == "abc" );
     CHECK( stx::string::trim_inplace(str4) == "" );
+
+    // zero-copy functions
+    std::string str5 = "  abc  ";
+    stx::string::string_ref ref = stx::string::trim_view(str5);
+    CHECK( ref == "abc" && ref.data() == str5.data() + 2 );
+    CHECK( stx::string::trim_left_view(str5) == "abc  " );
+    CHECK( stx::string::trim_right_view(str5) == "  abc" );
+    CHECK( stx::string::trim_view("   ").empty() );
+    CHECK( stx::string::trim_view("").empty() );
+
+    // precompiled and multi-character drop sets
+    stx::string::char_set ws(" \t\r\n");
+    CHECK( stx::string::trim("\t\r\n abc \r\n", ws) == "abc" );
+    CHECK( stx::string::trim("xyabcyx", "xy") == "abc" );
+    CHECK( stx::string::trim_left("xyabcyx", std::string("xy")) == "abcyx" );
+    CHECK( stx::string::trim_right("xyabcyx", "xy") == "xyabc" );
+
+    // long strings are trimmed by the SIMD kernels
+    std::string pad(100, ' '), body = "a b\tc";
+    std::string str6 = pad + "\t" + body + "\n" + pad;
+    CHECK( stx::string::trim_view(str6, ws) == body );
+    CHECK( stx::string::trim_left_inplace(str6, ws) == body + "\n" + pad );
+    CHECK( stx::string::trim_right_inplace(str6, ws) == body );
+    str6 = pad + body + pad;
+    CHECK( stx::string::trim_inplace(str6) == body );
+    str6 = pad + pad;
+    CHECK( stx::string::trim_inplace(str6, ws) == "" );
 }
 
 void test_toupper_tolower()
@@ -89,6 +123,27 @@ void test_toupper_tolower()
 
     CHECK( stx::string::toupper_inplace(str1) == "  ABC  " );
     CHECK( stx::string::tolower_inplace(str2) == "abcdefgh " );
+
+    // long strings with all byte values, non-ASCII bytes are unchanged
+    std::string all;
+    for (unsigned int i = 0; i < 3 * 256 + 7; ++i)
+        all += static_cast<char>(i);
+
+    std::string up = stx::string::toupper(all), low = stx::string::tolower(all);
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(all[i]);
+        CHECK( up[i] == static_cast<char>((c >= 'a' && c <= 'z') ? c - 32 : c) );
+        CHECK( low[i] == static_cast<char>((c >= 'A' && c <= 'Z') ? c + 32 : c) );
+    }
+
+    // tr-like byte translation
+    stx::string::byte_map rot13("abcdefghijklmnopqrstuvwxyz", "nopqrstuvwxyzabcdefghijklm");
+    CHECK( stx::string::translate("hello, world", rot13) == "uryyb, jbeyq" );
+
+    stx::string::byte_map digits("0123456789\xFF", "#");
+    std::string str3 = "call 555-0123 now \xFF, call 555-0123 now \xFE";
+    CHECK( stx::string::translate_inplace(str3, digits) == "call ###-#### now #, call ###-#### now \xFE" );
 }
 
 void test_compare_icase()
@@ -107,6 +162,174 @@ void test_compare_icase()
     CHECK( stx::string::compare_icase("ABC", "abc") == 0 );
     CHECK( stx::string::compare_icase("ABC", "abd") < 0  );
     CHECK( stx::string::compare_icase("ABC", "abb") > 0  );
+
+    CHECK( stx::string::is_prefix_icase("Content-Type: text/html", "content-TYPE") );
+    CHECK( stx::string::is_suffix_icase("Content-Type: text/html", "TEXT/HTML") );
+
+    // compare the kernels with the std::tolower based definitions on long
+    // strings differing at random positions
+    for (unsigned int ti = 0; ti < 1000; ++ti)
+    {
+        std::string a = stx::string::random(rand() % 100, "aAbB[@\xC4\xE4");
+        std::string b = a;
+        if (!b.empty() && ti % 4 != 0)
+            b[rand() % b.size()] = "aAbB[@\xC4\xE4"[rand() % 8];
+        if (ti % 5 == 0) b.resize(rand() % (b.size() + 1));
+
+        bool less = std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                                 stx::string::char_icase_less());
+        bool equal = a.size() == b.size() &&
+                     std::equal(a.begin(), a.end(), b.begin(), stx::string::char_icase_equal());
+
+        CHECK( stx::string::less_icase(a, b) == less );
+        CHECK( stx::string::equal_icase(a, b) == equal );
+        CHECK( (stx::string::compare_icase(a, b) == 0) == equal );
+        CHECK( stx::string::order_less_icase()(a, b) == less );
+    }
+}
+
+void test_icase_hash()
+{
+    stx::string::icase_hash hash;
+    stx::string::icase_equal equal;
+
+    // equal keys hash alike, for all kinds of keys
+    for (unsigned int ti = 0; ti < 500; ++ti)
+    {
+        std::string a = stx::string::random(rand() % 40, "aAzZ@[`{\xC1\xE1-");
+        std::string b = stx::string::toupper(a), c = stx::string::tolower(a);
+
+        CHECK( equal(a, b) && equal(b, c.c_str()) );
+        CHECK( hash(a) == hash(b) );
+        CHECK( hash(b) == hash(c.c_str()) );
+        CHECK( hash(a) == hash(stx::string::string_ref(c)) );
+        CHECK( equal(a, b) == stx::string::equal_icase(a, b) );
+    }
+
+    // only ASCII letters are folded
+    CHECK( hash("@") != hash("`") );
+    CHECK( hash("\xC1") != hash("\xE1") );
+    CHECK( !equal("\xC1", "\xE1") );
+    CHECK( hash("content-length") != hash("content-type") );
+
+#if __cplusplus >= 201103L
+    std::unordered_map<std::string, int, stx::string::icase_hash, stx::string::icase_equal> map;
+    map["Content-Type"] = 1;
+    map["content-length"] = 2;
+    CHECK( map["CONTENT-TYPE"] == 1 );
+    CHECK( map.count("Content-Length") == 1 );
+    CHECK( map.size() == 2 );
+#endif
+}
+
+void test_icase_string()
+{
+    using stx::string::icase_string;
+
+    icase_string a = "Content-Type";
+    CHECK( a == "content-TYPE" );
+    CHECK( a != "content-length" );
+    CHECK( a < "CONTENT-U" );
+    CHECK( a.find("type") == 8 );
+    CHECK( a.find('T') == 3 );
+    CHECK( a.find('-') == 7 );
+    CHECK( a.find('x') == icase_string::npos );
+    CHECK( icase_string(40, 'a').find('A') == 0 );
+    CHECK( (icase_string(40, 'b') + "a" + icase_string(40, 'A')).find('A') == 40 );
+
+    std::map<icase_string, int> map;
+    map["Host"] = 1;
+    map["HOST"] = 2;
+    map["accept"] = 3;
+    CHECK( map.size() == 2 );
+    CHECK( map["host"] == 2 );
+    CHECK( map.begin()->first == "ACCEPT" );
+
+    // mixed comparisons with std::string and string_ref fold case as well
+    std::string plain = "content-type";
+    stx::string::string_ref plain_ref = plain;
+    CHECK( a == plain && plain == a );
+    CHECK( a == plain_ref && plain_ref == a );
+    CHECK( !(a != plain) && !(plain_ref != a) );
+    CHECK( a < std::string("CONTENT-U") && std::string("CONTENT-U") > a );
+    CHECK( a <= plain && a >= plain_ref && !(a < plain) && !(plain > a) );
+    CHECK( a != std::string("content-typ") && std::string("content-typ") < a );
+
+    // views, hashes and literal comparisons
+    stx::string::string_ref ref = a;
+    CHECK( ref == "Content-Type" );
+    CHECK( stx::string::icase_hash()(a) == stx::string::icase_hash()("CONTENT-TYPE") );
+    CHECK( stx::string::equal_icase_literal(a, "CONTENT-type") );
+    CHECK( !stx::string::equal_icase_literal(a, "CONTENT-typ") );
+    CHECK( stx::string::equal_icase_literal("Transfer-Encoding: Chunked", "transfer-encoding: chunked") );
+
+    CHECK( stx::string::ascii_case_tables<>::lower['Q'] == 'q' );
+    CHECK( stx::string::ascii_case_tables<>::upper[0xE4] == 0xE4 );
+#if __cplusplus >= 201103L
+    static_assert(stx::string::ascii_case_tables<>::lower['A'] == 'a', "lower");
+    static_assert(stx::string::ascii_toupper('z') == 'Z', "upper");
+#endif
+}
+
+void test_utf8_casefold()
+{
+    using stx::string::utf8_fold_codepoint;
+
+    CHECK( utf8_fold_codepoint('Q') == 'q' );
+    CHECK( utf8_fold_codepoint(0xC4) == 0xE4 );         // A with diaeresis
+    CHECK( utf8_fold_codepoint(0x3A3) == 0x3C3 );       // capital sigma
+    CHECK( utf8_fold_codepoint(0x3C2) == 0x3C3 );       // final sigma
+    CHECK( utf8_fold_codepoint(0x41A) == 0x43A );       // cyrillic ka
+    CHECK( utf8_fold_codepoint(0x212A) == 'k' );        // kelvin sign
+    CHECK( utf8_fold_codepoint(0x17F) == 's' );         // long s
+    CHECK( utf8_fold_codepoint(0x1E9E) == 0xDF );       // capital sharp s
+    CHECK( utf8_fold_codepoint(0x100) == 0x101 );
+    CHECK( utf8_fold_codepoint(0x101) == 0x101 );
+    CHECK( utf8_fold_codepoint(0xFF21) == 0xFF41 );     // fullwidth A
+    CHECK( utf8_fold_codepoint(0x10400) == 0x10428 );   // deseret
+    CHECK( utf8_fold_codepoint(0x4E2D) == 0x4E2D );
+
+    CHECK( stx::string::utf8_casefold("Stra\xC3\x9F" "e \xC3\x84\xC3\x96\xC3\x9C \xCE\xA3\xCE\x8A\xCE\xA3\xCE\xA5\xCE\xA6\xCE\x9F\xCE\xA3")
+           == "stra\xC3\x9F" "e \xC3\xA4\xC3\xB6\xC3\xBC \xCF\x83\xCE\xAF\xCF\x83\xCF\x85\xCF\x86\xCE\xBF\xCF\x83" );
+    CHECK( stx::string::utf8_casefold("ABC \xFF\xC3 \xE2\x84\xAA") == "abc \xFF\xC3 k" );
+
+    CHECK( stx::string::equal_icase_utf8("M\xC3\x9CNCHEN", "m\xC3\xBCnchen") );
+    CHECK( !stx::string::equal_icase_utf8("M\xC3\x9CNCHEN", "munchen") );
+    CHECK( stx::string::equal_icase_utf8("\xE2\x84\xAA" "elvin", "KELVIN") );
+    CHECK( stx::string::less_icase_utf8("\xE2\x84\xAA", "KA") );
+    CHECK( stx::string::compare_icase_utf8("\xC3\x84", "\xC3\xA4") == 0 );
+    CHECK( stx::string::compare_icase_utf8("\xC3", "\xC3\xA4") < 0 );
+    CHECK( stx::string::compare_icase_utf8("\xC3\xA4", "z") > 0 );
+
+    // compare with the order of the case folded strings on random valid UTF-8
+    static const char* pieces[] = {
+        "a", "A", "k", "K", "\xE2\x84\xAA", "\xC3\xA4", "\xC3\x84", "\xC3\x9F",
+        "\xCE\xA3", "\xCF\x83", "\xCF\x82", "\xF0\x90\x90\x80", "\xF0\x90\x90\xA8", "-"
+    };
+    stx::string::icase_utf8_hash hash;
+    for (unsigned int ti = 0; ti < 2000; ++ti)
+    {
+        std::string a, b;
+        for (int i = rand() % 40; i > 0; --i) a += pieces[rand() % 14];
+        b = (ti % 3 == 0) ? stx::string::utf8_casefold(a) : "";
+        for (int i = rand() % 40; i > 0 && ti % 3 != 0; --i) b += pieces[rand() % 14];
+
+        std::string fa = stx::string::utf8_casefold(a), fb = stx::string::utf8_casefold(b);
+        int c = fa.compare(fb);
+        int r = stx::string::compare_icase_utf8(a, b);
+        CHECK( (c < 0) == (r < 0) && (c == 0) == (r == 0) );
+        if (r == 0) CHECK( hash(a) == hash(b) );
+
+        std::string::size_type m = stx::string::find_icase_utf8(a, "\xCF\x82K");
+        CHECK( (m == std::string::npos) == (fa.find("\xCF\x83k") == std::string::npos) );
+    }
+
+    std::string text = "Gr\xC3\xBC\xC3\x9F" "e aus M\xC3\x9CNCHEN und M\xC3\xBCnchen";
+    CHECK( stx::string::find_icase_utf8(text, "m\xC3\xBCnchen") == text.find("M\xC3\x9CNCHEN") );
+    CHECK( stx::string::find_icase_utf8(text, "m\xC3\xBCnchen", 14) == text.find("M\xC3\xBCnchen") );
+    CHECK( stx::string::find_icase_utf8(text, "GR\xC3\x9C\xC3\x9F" "E") == 0 );
+    CHECK( stx::string::find_icase_utf8(text, "berlin") == std::string::npos );
+    CHECK( stx::string::find_icase_utf8("\xE2\x84\xAA" "elvin", "kel") == 0 );
 }
 
 void test_sstream()
@@ -168,6 +391,180 @@ void test_replace()
     str2 = "abcdef abcdef";
     CHECK( stx::string::replace_first_inplace(str1, "a", "aaa") == "aaabcdef abcdef" );
     CHECK( stx::string::replace_all_inplace(str2, "a", "aaa") == "aaabcdef aaabcdef" );
+
+    // overlapping needles are replaced from left to right
+    CHECK( stx::string::replace_all("aaaaa", "aa", "b") == "bba" );
+    CHECK( stx::string::replace_all("aaaaa", "aa", "") == "a" );
+    str1 = "aaaaa";
+    CHECK( stx::string::replace_all_inplace(str1, "aa", "ab") == "ababa" );
+    str1 = "xaaxaax";
+    CHECK( stx::string::replace_all_inplace(str1, "aa", "") == "xxx" );
+
+    // empty needle matches nothing
+    CHECK( stx::string::replace_all("abc", "", "x") == "abc" );
+    str1 = "abc";
+    CHECK( stx::string::replace_all_inplace(str1, "", "x") == "abc" );
+
+    // compare with replacing one by one on random strings
+    for (unsigned int i = 0; i < 1000; ++i)
+    {
+        std::string s = stx::string::random(rand() % 64, "ab");
+        std::string needle = stx::string::random(rand() % 3 + 1, "ab");
+        std::string instead = stx::string::random(rand() % 5, "abc");
+
+        std::string expect = s;
+        std::string::size_type pos = 0;
+        while ( (pos = expect.find(needle, pos)) != std::string::npos) {
+            expect.replace(pos, needle.size(), instead);
+            pos += instead.size();
+        }
+
+        CHECK( stx::string::replace_all(s, needle, instead) == expect );
+        CHECK( stx::string::replace_all_inplace(s, needle, instead) == expect );
+    }
+}
+
+//! leftmost-longest multi-pattern replacement by brute force
+static std::string multi_replace_naive(const std::string& s, const std::map<std::string, std::string>& m, bool fold_case)
+{
+    std::string out;
+    size_t i = 0;
+    while (i < s.size())
+    {
+        std::map<std::string, std::string>::const_iterator best = m.end();
+        for (std::map<std::string, std::string>::const_iterator it = m.begin(); it != m.end(); ++it)
+        {
+            const std::string& n = it->first;
+            if (n.empty() || n.size() > s.size() - i) continue;
+            bool match = fold_case ? stx::string::equal_icase(s.substr(i, n.size()), n)
+                : s.compare(i, n.size(), n) == 0;
+            if (match && (best == m.end() || n.size() > best->first.size()))
+                best = it;
+        }
+        if (best == m.end()) {
+            out += s[i++];
+        }
+        else {
+            out += best->second;
+            i += best->first.size();
+        }
+    }
+    return out;
+}
+
+void test_multi_replacer()
+{
+    std::map<std::string, std::string> m;
+    m["{{name}}"] = "World";
+    m["{{greeting}}"] = "Hello";
+    m["{{"] = "<";
+    m["he"] = "HE";
+    m["hers"] = "HERS";
+    m["she"] = "SHE";
+
+    stx::string::multi_replacer r(m);
+    CHECK( r.size() == 6 );
+    CHECK( r.replace("{{greeting}}, {{name}}!") == "Hello, World!" );
+    CHECK( r.replace("{{unknown}} {{") == "<unknown}} <" );
+    CHECK( r.replace("ushers") == "uSHErs" );
+    CHECK( r.replace("hershe") == "HERSHE" );
+    CHECK( r.replace("") == "" );
+
+    stx::string::multi_replacer ri(m, true);
+    CHECK( ri.replace("{{NAME}} uHeRs") == "World uHERS" );
+
+    std::string out = "x";
+    ri.replace("He", out);
+    CHECK( out == "xHE" );
+
+    // compare with brute force on random needles and strings
+    for (unsigned int i = 0; i < 200; ++i)
+    {
+        std::map<std::string, std::string> rm;
+        for (unsigned int j = rand() % 6; j != 0; --j)
+            rm[stx::string::random(rand() % 4, "abA")] = stx::string::random(rand() % 3, "xy");
+
+        bool fold_case = (i % 2 != 0);
+        stx::string::multi_replacer mr(rm, fold_case);
+
+        for (unsigned int k = 0; k < 10; ++k) {
+            std::string s = stx::string::random(rand() % 32, "abAc");
+            CHECK( mr.replace(s) == multi_replace_naive(s, rm, fold_case) );
+        }
+    }
+}
+
+void test_scan()
+{
+    // compare all scanning kernels supported by the CPU with the scalar ones
+    using namespace stx::string;
+
+    scan_kernels scalar = scan_get_kernels(scan_isa_scalar);
+    static const char cset[] = "ab,\t\n\r \xE4\x7F";
+    char_set set(",\xE4\x7F");
+    byte_map tmap("ab,\t\xE4", "xy;_\x01");
+
+    for (int isa = scan_isa_sse2; isa <= scan_detect_isa(); ++isa)
+    {
+        scan_kernels k = scan_get_kernels(static_cast<scan_isa>(isa));
+
+        for (unsigned int ti = 0; ti < 2000; ++ti)
+        {
+            std::string str = stx::string::random(
+                rand() % 200, std::string(cset, (ti % 9) + 1));
+            const char* end = str.data() + str.size();
+
+            for (size_t i = 0; i <= str.size(); i += 1 + rand() % 8)
+            {
+                const char* p = str.data() + i;
+                CHECK( k.find_char(p, end, ',') == scalar.find_char(p, end, ',') );
+                CHECK( k.find_ws(p, end) == scalar.find_ws(p, end) );
+                CHECK( k.find_not_ws(p, end) == scalar.find_not_ws(p, end) );
+                CHECK( k.find_set(p, end, set) == scalar.find_set(p, end, set) );
+                CHECK( k.find_not_set(p, end, set) == scalar.find_not_set(p, end, set) );
+                CHECK( k.rfind_not_set(p, end, set) == scalar.rfind_not_set(p, end, set) );
+            }
+
+            // case mapping and translation kernels, in-place and copying
+            std::string out1 = str, out2 = str;
+            k.map_case(str.data(), end, &out1[0], 'A');
+            scalar.map_case(str.data(), end, &out2[0], 'A');
+            CHECK( out1 == out2 );
+
+            k.translate(out1.data(), out1.data() + out1.size(), &out1[0], tmap);
+            scalar.translate(out2.data(), out2.data() + out2.size(), &out2[0], tmap);
+            CHECK( out1 == out2 );
+
+            std::string str2 = stx::string::toupper(str);
+            size_t n = str.size();
+            if (n != 0) str2[rand() % n] = cset[rand() % 9];
+            CHECK( k.mismatch_icase(str.data(), str2.data(), n) == scalar.mismatch_icase(str.data(), str2.data(), n) );
+            CHECK( k.find_non_ascii(str.data(), end) == scalar.find_non_ascii(str.data(), end) );
+
+            size_t off = rand() % 4;
+            if (n > off) {
+                CHECK( k.find_pair_icase(str.data(), end - off, 'a', 'b', off) ==
+                       scalar.find_pair_icase(str.data(), end - off, 'a', 'b', off) );
+                CHECK( k.find_pair(str.data(), end - off, 'a', ',', off) ==
+                       scalar.find_pair(str.data(), end - off, 'a', ',', off) );
+            }
+        }
+
+        // CSV quote masks with the quoting state carried across blocks
+        std::string str = stx::string::random(64 * 200, "ab,\"");
+        unsigned long long kq = 0, sq = 0;
+        for (size_t i = 0; i < str.size(); i += 64)
+        {
+            CHECK( k.csv_block(str.data() + i, ',', kq) == scalar.csv_block(str.data() + i, ',', sq) );
+            CHECK( kq == sq );
+        }
+    }
+
+    std::string str(100, ' ');
+    str[70] = 'x';
+    CHECK( find_not_split_ws(str.data(), str.data() + str.size()) == str.data() + 70 );
+    CHECK( find_char(str.data(), str.data() + str.size(), 'x') == str.data() + 70 );
+    CHECK( find_split_ws(str.data() + 70, str.data() + str.size()) == str.data() + 71 );
 }
 
 void test_split_ws()
@@ -272,6 +669,300 @@ void test_split()
     CHECK( sv[0] == "test" && sv[1] == "blah" && sv[2] == "" && sv[3] == "ab" );
 }
 
+void test_split_view()
+{
+    // integer sizes, including a literal zero, select the size constructor
+    const char* abc = "abc";
+    CHECK( stx::string::string_ref(abc, 0).empty() );
+    CHECK( stx::string::string_ref(abc, 0).data() == abc );
+    CHECK( stx::string::string_ref(abc, 2) == "ab" );
+    CHECK( stx::string::string_ref(abc, abc + 3) == "abc" );
+    CHECK( stx::string::string_ref(abc, static_cast<std::ptrdiff_t>(1)) == "a" );
+    CHECK( stx::string::string_ref(abc, static_cast<unsigned long long>(3)) == "abc" );
+
+    // split views must match the copying split functions exactly
+    static const char* inputs[] = {
+        "", "    ", "  ab c df  fdlk f  ", "/usr/bin/test", "/usr//bin/test/",
+        "testabcblahabcabcab", "abcabc", "a\tb\nc\rd e"
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        std::string str = inputs[i];
+
+        for (std::string::size_type limit = 0; limit < 8; ++limit)
+        {
+            std::string::size_type lim = (limit == 7) ? std::string::npos : limit;
+
+            std::vector<std::string> sv = stx::string::split_ws(str, lim);
+            std::vector<stx::string::string_ref> rv = stx::string::split_ws_view(str, lim);
+            CHECK( sv.size() == rv.size() );
+            for (size_t j = 0; j < sv.size(); ++j)
+                CHECK( rv[j] == sv[j] );
+
+            sv = stx::string::split(str, '/', lim);
+            rv = stx::string::split_view(str, '/', lim);
+            CHECK( sv.size() == rv.size() );
+            for (size_t j = 0; j < sv.size(); ++j)
+                CHECK( rv[j] == sv[j] );
+
+            sv = stx::string::split(str, "abc", lim);
+            rv = stx::string::split_view(str, "abc", lim);
+            CHECK( sv.size() == rv.size() );
+            for (size_t j = 0; j < sv.size(); ++j)
+                CHECK( rv[j] == sv[j] );
+        }
+    }
+
+    // views point into the original string
+    std::string str = "/usr/bin/test";
+    std::vector<stx::string::string_ref> rv = stx::string::split_view(str, '/');
+
+    CHECK( rv.size() == 4 );
+    CHECK( rv[0].empty() && rv[1] == "usr" && rv[2] == "bin" && rv[3] == "test" );
+    CHECK( rv[1].data() == str.data() + 1 );
+    CHECK( rv[3].str() == "test" );
+    CHECK( !(rv[1] < rv[2]) && rv[2] < rv[3] );
+}
+
+void test_split_range()
+{
+    typedef stx::string::token_range<stx::string::split_tokenizer> char_range;
+
+    // lazy ranges must deliver the same parts as the split functions
+    static const char* inputs[] = {
+        "", "    ", "  ab c df  fdlk f  ", "/usr/bin/test", "/usr//bin/test/",
+        "testabcblahabcabcab", "abcabc"
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        std::string str = inputs[i];
+
+        for (std::string::size_type limit = 0; limit < 6; ++limit)
+        {
+            std::vector<std::string> sv = stx::string::split_ws(str, limit);
+            std::vector<stx::string::string_ref> rv;
+
+            rv.assign(stx::string::split_ws_range(str, limit).begin(),
+                      stx::string::split_ws_range(str, limit).end());
+            CHECK( rv.size() == sv.size() );
+            for (size_t j = 0; j < sv.size(); ++j)
+                CHECK( rv[j] == sv[j] );
+
+            sv = stx::string::split(str, '/', limit);
+            char_range cr = stx::string::split_range(str, '/', limit);
+            CHECK( static_cast<size_t>(std::distance(cr.begin(), cr.end())) == sv.size() );
+
+            size_t j = 0;
+            for (char_range::iterator it = cr.begin(); it != cr.end(); ++it, ++j)
+                CHECK( *it == sv[j] );
+
+            sv = stx::string::split(str, "abc", limit);
+            CHECK( static_cast<size_t>(std::distance(
+                       stx::string::split_range(str, "abc", limit).begin(),
+                       stx::string::split_range(str, "abc", limit).end())) == sv.size() );
+        }
+    }
+
+    // early exit after the first field
+    std::string line = "first,second,third";
+    char_range cr = stx::string::split_range(line, ',');
+    CHECK( *cr.begin() == "first" );
+    CHECK( cr.begin()->data() == line.data() );
+
+#if __cplusplus >= 201103L
+    std::string joined;
+    for (const stx::string::string_ref& part : stx::string::split_ws_range("  a b  c "))
+        joined += part.str();
+    CHECK( joined == "abc" );
+#endif
+}
+
+void test_split_parallel()
+{
+#if STX_STRING_THREADS
+    // compare with the sequential functions for various thread counts, chunk
+    // boundaries and limits
+    for (unsigned int ti = 0; ti < 300; ++ti)
+    {
+        std::string str = stx::string::random(rand() % 300, "ab, \t");
+        unsigned int threads = 1 + ti % 7;
+        std::string::size_type limit =
+            (ti % 3 == 0) ? std::string::npos : static_cast<std::string::size_type>(rand() % 40);
+
+        CHECK( stx::string::split_parallel(str, ',', limit, threads) == stx::string::split(str, ',', limit) );
+        CHECK( stx::string::split_view_parallel(str, ',', limit, threads) == stx::string::split_view(str, ',', limit) );
+        CHECK( stx::string::split_ws_parallel(str, limit, threads) == stx::string::split_ws(str, limit) );
+        CHECK( stx::string::split_ws_view_parallel(str, limit, threads) == stx::string::split_ws_view(str, limit) );
+    }
+
+    std::string big;
+    for (unsigned int i = 0; i < 100000; ++i)
+        big += stx::string::to_str(i) + (i % 10 == 9 ? "\n" : " ");
+
+    std::vector<std::string> sv = stx::string::split_ws_parallel(big);
+    CHECK( sv.size() == 100000 );
+    CHECK( sv[99999] == "99999" );
+    CHECK( stx::string::split_view_parallel(big, '\n', 3, 4).size() == 3 );
+#endif
+}
+
+void test_split_any()
+{
+    // a single character set behaves like split() and the whitespace set with
+    // collapsing like split_ws()
+    static const char* inputs[] = {
+        "", "    ", "  ab c df  fdlk f  ", "/usr/bin/test", "/usr//bin/test/",
+        "a\tb\nc\rd e", "a,b;;c|d\te,", ";;;"
+    };
+
+    stx::string::char_set ws(" \t\n\r");
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i)
+    {
+        std::string str = inputs[i];
+
+        for (std::string::size_type limit = 0; limit < 6; ++limit)
+        {
+            CHECK( stx::string::split_any(str, "/", limit) == stx::string::split(str, '/', limit) );
+            CHECK( stx::string::split_any_collapse(str, ws, limit) == stx::string::split_ws(str, limit) );
+        }
+    }
+
+    std::vector<std::string> sv = stx::string::split_any("a,b;;c|d\te,", ",;|\t");
+    CHECK( sv.size() == 6 );
+    CHECK( sv[0] == "a" && sv[1] == "b" && sv[2] == "" && sv[3] == "c" && sv[4] == "d" && sv[5] == "e" );
+
+    sv = stx::string::split_any_collapse(";a,b;;c|d\te,", ",;|\t", 4);
+    CHECK( sv.size() == 4 );
+    CHECK( sv[0] == "a" && sv[1] == "b" && sv[2] == "c" && sv[3] == "d\te," );
+
+    // compare with a find_first_of() based reference on long random strings
+    stx::string::char_set set(",;|\xE4");
+    for (unsigned int ti = 0; ti < 200; ++ti)
+    {
+        std::string str = stx::string::random(rand() % 300, "abc,;|\xE4");
+
+        std::vector<std::string> ref;
+        std::string::size_type last = 0, pos;
+        while ((pos = str.find_first_of(",;|\xE4", last)) != std::string::npos) {
+            ref.push_back(str.substr(last, pos - last));
+            last = pos + 1;
+        }
+        if (last != str.size()) ref.push_back(str.substr(last));
+
+        CHECK( stx::string::split_any(str, set) == ref );
+
+        std::vector<stx::string::string_ref> rv = stx::string::split_any_view(str, set);
+        CHECK( rv.size() == ref.size() );
+        CHECK( static_cast<size_t>(std::distance(
+                   stx::string::split_any_range(str, set).begin(),
+                   stx::string::split_any_range(str, set).end())) == ref.size() );
+
+        size_t nonempty = 0;
+        for (size_t j = 0; j < ref.size(); ++j)
+            nonempty += !ref[j].empty();
+        CHECK( stx::string::split_any_collapse_view(str, set).size() == nonempty );
+    }
+}
+
+void test_split_csv()
+{
+    using stx::string::string_ref;
+
+    std::vector<string_ref> sv = stx::string::split_csv_view("a,\"b,c\",,\"d\"\"e\",");
+    CHECK( sv.size() == 5 );
+    CHECK( sv[0] == "a" );
+    CHECK( sv[1] == "\"b,c\"" );
+    CHECK( sv[2] == "" );
+    CHECK( sv[3] == "\"d\"\"e\"" );
+    CHECK( sv[4] == "" );
+
+    CHECK( stx::string::csv_unescape(sv[1]) == "b,c" );
+    CHECK( stx::string::csv_unescape(sv[3]) == "d\"e" );
+    CHECK( stx::string::csv_unescape("\"\"") == "" );
+    CHECK( stx::string::csv_unescape("plain") == "plain" );
+
+    // TSV, limit and empty records
+    std::vector<std::string> s = stx::string::split_csv("x\t\"y\ty\"\tz", '\t');
+    CHECK( s.size() == 3 );
+    CHECK( s[0] == "x" && s[1] == "y\ty" && s[2] == "z" );
+
+    sv = stx::string::split_csv_view("a,\"b,b\",c,d", ',', 2);
+    CHECK( sv.size() == 2 );
+    CHECK( sv[0] == "a" && sv[1] == "\"b,b\",c,d" );
+
+    CHECK( stx::string::split_csv("").size() == 0 );
+    CHECK( stx::string::split_csv(",").size() == 2 );
+    CHECK( stx::string::split_csv("a", ',', 0).size() == 0 );
+
+    // compare with a plain scalar reference on long records, with quoted
+    // fields straddling the 64 byte blocks
+    for (unsigned int ti = 0; ti < 200; ++ti)
+    {
+        std::string rec = stx::string::random(rand() % 400, "ab,\"\n");
+
+        std::vector<string_ref> ref;
+        bool quoted = false;
+        const char* field = rec.data();
+        for (const char* p = rec.data(); p != rec.data() + rec.size(); ++p)
+        {
+            if (*p == '"') quoted = !quoted;
+            else if (*p == ',' && !quoted) {
+                ref.push_back(string_ref(field, p));
+                field = p + 1;
+            }
+        }
+        if (!rec.empty()) ref.push_back(string_ref(field, rec.data() + rec.size()));
+
+        CHECK( stx::string::split_csv_view(rec) == ref );
+    }
+}
+
+void test_string_table()
+{
+    stx::string::string_table st;
+    CHECK( st.empty() && st.size() == 0 );
+
+    // append split parts of several lines into the same table
+    stx::string::split(st, "/usr/bin/test", '/');
+    CHECK( st.size() == 4 );
+    CHECK( st[0] == "" && st[1] == "usr" && st[2] == "bin" && st[3] == "test" );
+
+    stx::string::split_ws(st, "  ab c ", 1);
+    stx::string::split(st, "xxabcyy", "abc");
+    CHECK( st.size() == 7 );
+    CHECK( st[4] == "ab c " && st[5] == "xx" && st[6] == "yy" );
+    CHECK( st.chars() == 10 + 5 + 4 );
+
+    CHECK( stx::string::join(";", st) == ";usr;bin;test;ab c ;xx;yy" );
+    CHECK( std::distance(st.begin(), st.end()) == 7 );
+    CHECK( *(st.begin() + 2) == "bin" );
+    CHECK( *(2 + st.begin()) == "bin" );
+    CHECK( st.end() > st.begin() && st.begin() < st.end() );
+    CHECK( st.begin() <= st.begin() && st.end() >= st.begin() );
+    CHECK( !(st.begin() >= st.end()) && !(st.end() <= st.begin()) );
+
+    // clear() keeps the capacity for reuse
+    st.clear();
+    CHECK( st.empty() );
+    CHECK( stx::string::join(";", st) == "" );
+
+    stx::string::split_any(st, "a,b;c", ",;");
+    CHECK( st.size() == 3 );
+    CHECK( stx::string::join("-", st) == "a-b-c" );
+
+    // the table matches the vector split functions
+    std::string line = "  ab c df  fdlk f  ";
+    st.clear();
+    stx::string::split_ws(st, line, 3);
+    std::vector<std::string> sv = stx::string::split_ws(line, 3);
+    CHECK( st.size() == sv.size() );
+    for (size_t i = 0; i < sv.size(); ++i)
+        CHECK( st[i] == sv[i] );
+}
+
 void test_join()
 {
     // simple string split and join
@@ -286,6 +977,99 @@ void test_join()
         sv2.push_back("abc");
 
     CHECK( stx::string::join(".", sv2) == "abc.abc.abc.abc.abc.abc" );
+
+    // join mixed pieces: string_refs and integers
+    std::vector<stx::string::string_ref> rv = stx::string::split_view("a b c", ' ');
+    CHECK( stx::string::join(", ", rv.begin(), rv.end()) == "a, b, c" );
+
+    std::vector<int> iv;
+    iv.push_back(1); iv.push_back(-20); iv.push_back(300);
+    CHECK( stx::string::join("+", iv.begin(), iv.end()) == "1+-20+300" );
+
+    const char* cv[] = { "x", "y" };
+    CHECK( stx::string::join("", cv, cv + 2) == "xy" );
+
+    // join from an input iterator
+    std::istringstream iss("in put it");
+    CHECK( stx::string::join("_", std::istream_iterator<std::string>(iss),
+                             std::istream_iterator<std::string>()) == "in_put_it" );
+
+    // append join to an existing string
+    std::string out = "list:";
+    stx::string::join_to(out, ",", sv2.begin(), sv2.begin() + 2);
+    CHECK( out == "list:abc,abc" );
+}
+
+void test_concat()
+{
+    std::string name = "world";
+    stx::string::string_ref ref = stx::string::string_ref(name).substr(1, 3);
+
+    std::string s = stx::string::concat("hello ") + name + ' ' + 42 + ' ' + ref;
+    CHECK( s == "hello world 42 orl" );
+
+    CHECK( (stx::string::concat(-7) + 0 + 18446744073709551615ull).str() == "-7018446744073709551615" );
+    CHECK( (stx::string::concat(-2147483647 - 1) + "|" + 4294967295u).str() == "-2147483648|4294967295" );
+
+    // copies of expressions keep formatted integers intact
+    std::vector<std::string> v;
+    v.push_back(stx::string::concat("n") + 123);
+    CHECK( v[0] == "n123" );
+
+    // append to a caller-owned buffer with one reservation
+    std::string out = "x";
+    stx::string::append_to(out, stx::string::concat('=') + 1 + "," + 2);
+    CHECK( out == "x=1,2" );
+    CHECK( out.capacity() >= 5 );
+}
+
+void test_record_reader()
+{
+    // records straddling chunks, empty records, long records growing the
+    // buffer and a final record without delimiter
+    std::string text = "abc\n\nde\n" + std::string(100, 'x') + "\nlast";
+    for (unsigned int i = 0; i < 200; ++i)
+        text += stx::string::random(rand() % 50, "abc \n");
+
+    for (size_t chunk = 1; chunk <= 64; chunk *= 4)
+    {
+        std::istringstream iss1(text), iss2(text);
+        stx::string::istream_record_reader rr(stx::string::istream_record_source(iss1), '\n', chunk);
+
+        stx::string::string_ref rec;
+        std::string line;
+        while (std::getline(iss2, line)) {
+            CHECK( rr.next(rec) );
+            CHECK( rec == line );
+        }
+        CHECK( !rr.next(rec) );
+    }
+
+    // trailing delimiter does not produce an empty record
+    std::istringstream iss("a;b;");
+    stx::string::istream_record_reader rr(stx::string::istream_record_source(iss), ';', 2);
+    stx::string::string_ref rec;
+    CHECK( rr.next(rec) && rec == "a" );
+    CHECK( rr.next(rec) && rec == "b" );
+    CHECK( !rr.next(rec) );
+
+#if defined(__unix__) || defined(__APPLE__)
+    FILE* tmp = tmpfile();
+    CHECK( tmp != NULL );
+    fwrite(text.data(), 1, text.size(), tmp);
+    fflush(tmp);
+    rewind(tmp);
+
+    std::istringstream iss2(text);
+    stx::string::fd_record_reader fr(stx::string::fd_record_source(fileno(tmp)), '\n', 16);
+    std::string line;
+    while (std::getline(iss2, line)) {
+        CHECK( fr.next(rec) );
+        CHECK( rec == line );
+    }
+    CHECK( !fr.next(rec) );
+    fclose(tmp);
+#endif
 }
 
 void test_contains()
@@ -299,6 +1083,74 @@ void test_contains()
     CHECK( stx::string::contains_word(data, "readall") );
 
     CHECK( !stx::string::contains_word(data, "doit") );
+    CHECK( !stx::string::contains_word(data, "") );
+
+    CHECK( stx::string::contains_word("\tfirst\r\nsecond\n", "second") );
+    CHECK( !stx::string::contains_word("  ", "second") );
+}
+
+void test_word_matcher()
+{
+    std::vector<std::string> words;
+    words.push_back("read");
+    words.push_back("write");
+    words.push_back("");
+    words.push_back("Admin");
+    words.push_back("read");
+
+    stx::string::word_matcher wm(words);
+    CHECK( wm.size() == 5 );
+    CHECK( wm.word(3) == "Admin" );
+    CHECK( wm.lookup("read") == 0 );
+    CHECK( wm.lookup("Admin") == 3 );
+    CHECK( wm.lookup("admin") == std::string::npos );
+    CHECK( wm.lookup("") == std::string::npos );
+    CHECK( !wm.contains("readall") );
+
+    std::string data = "test Admin\twrite readall read do\r\nread";
+    CHECK( wm.find_first(data) == "Admin" );
+    CHECK( wm.find_first(data).data() == data.data() + 5 );
+    CHECK( wm.find_first("readall do").empty() );
+    CHECK( wm.find_first("").empty() );
+
+    std::vector<stx::string::string_ref> all = wm.find_all(data);
+    CHECK( all.size() == 4 );
+    CHECK( all[0] == "Admin" && all[1] == "write" && all[2] == "read" && all[3] == "read" );
+
+    std::vector<size_t> counts = wm.count(data);
+    CHECK( counts.size() == 5 );
+    CHECK( counts[0] == 2 && counts[1] == 1 && counts[2] == 0 && counts[3] == 1 && counts[4] == 0 );
+
+    const char* icase_words[] = { "STOP", "the", "a" };
+    stx::string::word_matcher wi(icase_words, icase_words + 3, true);
+    CHECK( wi.lookup("stop") == 0 );
+    CHECK( wi.lookup("The") == 1 );
+    CHECK( wi.find_first("xyz THE a") == "THE" );
+    CHECK( wi.find_all("A stop-word").size() == 1 );
+
+    stx::string::word_matcher none(std::vector<std::string>(), true);
+    CHECK( none.find_first("any words").empty() );
+    CHECK( none.count("any words").empty() );
+
+    // compare with contains_word() for a large set of random words
+    words.clear();
+    for (unsigned int i = 0; i < 500; ++i)
+        words.push_back(stx::string::random(rand() % 4 + 1, "abc"));
+    stx::string::word_matcher wr(words);
+
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        std::string doc = stx::string::random(rand() % 100, "abcd \t\n");
+        std::vector<size_t> c = wr.count(doc);
+        for (size_t w = 0; w < words.size(); ++w)
+        {
+            if (wr.lookup(words[w]) == w)
+                CHECK( (c[w] != 0) == stx::string::contains_word(doc, words[w]) );
+            else
+                CHECK( c[w] == 0 );
+        }
+        CHECK( wr.find_first(doc).empty() == (wr.find_all(doc).size() == 0) );
+    }
 }
 
 void test_extract_between()
@@ -311,6 +1163,141 @@ void test_extract_between()
 
     CHECK( stx::string::extract_between(data, "Name='", "'") == "" );
     CHECK( stx::string::extract_between_icase(data, "Name='", "'") == "testfile" );
+    CHECK( stx::string::extract_between_icase(data, "FILENAME='", "\"") == "" );
+}
+
+void test_find_icase()
+{
+    using stx::string::find_icase;
+
+    std::string text = "The Quick Brown Fox Jumps Over The Lazy Dog";
+    CHECK( find_icase(text, "quick") == 4 );
+    CHECK( find_icase(text, "THE", 1) == 31 );
+    CHECK( find_icase(text, "dog") == 40 );
+    CHECK( find_icase(text, "cat") == std::string::npos );
+    CHECK( find_icase(text, "") == 0 );
+    CHECK( find_icase(text, "", text.size()) == text.size() );
+    CHECK( find_icase(text, "", text.size() + 1) == std::string::npos );
+    CHECK( find_icase(text, "q", 100) == std::string::npos );
+    CHECK( find_icase("abc", "abcd") == std::string::npos );
+    CHECK( find_icase("", "a") == std::string::npos );
+
+    // every position is a prefilter candidate, which switches to Two-Way
+    for (size_t n = 3; n <= 600; n += 199)
+    {
+        std::string hay(20000, 'a'), needle(n - 2, 'a');
+        needle += "ba";
+        CHECK( find_icase(hay, needle) == std::string::npos );
+        hay.replace(15000, n, stx::string::toupper(needle));
+        CHECK( find_icase(hay, needle) == 15000 );
+        CHECK( find_icase(hay, needle, 15001) == std::string::npos );
+        CHECK( stx::string::searcher(needle).find(hay) == std::string::npos );
+        CHECK( stx::string::searcher(needle, true).find(hay) == 15000 );
+    }
+
+    // compare with a naive search for short needles and long ones searched by
+    // the Two-Way algorithm
+    for (unsigned int i = 0; i < 2000; ++i)
+    {
+        std::string hay = stx::string::random(rand() % 600, "aAbB\xE4");
+        std::string needle = (i % 2 == 0)
+            ? stx::string::random(rand() % 5 + 1, "aAbB")
+            : (i % 4 == 1)
+            ? stx::string::random(rand() % 8 + 32, "aAbB")
+            : stx::string::random(rand() % 8 + 256, "aAbB");
+        if (i % 3 == 0 && hay.size() > needle.size())
+            hay.replace(rand() % (hay.size() - needle.size()), needle.size(),
+                        stx::string::toupper(needle));
+
+        std::string::size_type expect = std::string::npos;
+        for (std::string::size_type p = 0; p + needle.size() <= hay.size(); ++p) {
+            if (stx::string::equal_icase(hay.substr(p, needle.size()), needle)) {
+                expect = p;
+                break;
+            }
+        }
+        CHECK( find_icase(hay, needle) == expect );
+    }
+}
+
+void test_searcher()
+{
+    using stx::string::searcher;
+
+    searcher abc("abc"), ABC("ABC", true), empty("");
+
+    CHECK( abc.find("xxabcabc") == 2 );
+    CHECK( abc.find("xxabcabc", 3) == 5 );
+    CHECK( abc.find("xxabcabc", 6) == std::string::npos );
+    CHECK( abc.find("xxabcabc", 9) == std::string::npos );
+    CHECK( abc.find("xxABC") == std::string::npos );
+    CHECK( ABC.find("xxaBc") == 2 );
+    CHECK( empty.find("xyz", 3) == 3 );
+    CHECK( empty.find("xyz", 4) == std::string::npos );
+    CHECK( searcher("x").find("abcx") == 3 );
+    CHECK( searcher("X", true).find("abcx") == 3 );
+    CHECK( searcher("/", true).find("a/b") == 1 );
+
+    CHECK( stx::string::find_icase("The ABC song", ABC) == 4 );
+    CHECK_THROW( stx::string::find_icase("The ABC song", abc), std::runtime_error );
+
+    CHECK( stx::string::replace_first("abcdabcd", abc, "x") == "xdabcd" );
+    CHECK( stx::string::replace_all("abcdABcd", ABC, "x") == "xdxd" );
+    CHECK( stx::string::replace_all("abcd", empty, "x") == "abcd" );
+
+    std::string str = "AbcxaBcx";
+    stx::string::replace_all_inplace(str, ABC, "y");
+    CHECK( str == "yxyx" );
+    stx::string::replace_all_inplace(str, searcher("x"), "zz");
+    CHECK( str == "yzzyzz" );
+
+    CHECK( stx::string::extract_between("foo <b>bar</B> baz", searcher("<b>", true),
+                                         searcher("</b>", true)) == "bar" );
+    CHECK( stx::string::extract_between("foo <b>bar</B> baz", searcher("<b>"),
+                                         searcher("</b>")) == "" );
+
+    std::vector<std::string> sv = stx::string::split("testabcblahABCabcab", ABC);
+    CHECK( sv.size() == 4 );
+    CHECK( sv[0] == "test" && sv[1] == "blah" && sv[2] == "" && sv[3] == "ab" );
+    CHECK( stx::string::split("abc", empty).size() == 0 );
+
+    // compare with std::string::find() and a naive case-insensitive search,
+    // including long periodic needles searched by the Two-Way algorithm
+    for (unsigned int i = 0; i < 3000; ++i)
+    {
+        std::string hay = stx::string::random(rand() % 1000, "aAbB\xE4");
+        std::string needle;
+        switch (i % 4)
+        {
+        case 0:
+            needle = stx::string::random(rand() % 4 + 1, "aAbB");
+            break;
+        case 1:
+            needle = stx::string::random(rand() % 8 + 20, "abB");
+            break;
+        case 2:
+            needle = stx::string::random(rand() % 40 + 256, "ab");
+            break;
+        default:
+            for (size_t n = rand() % 40 + 256; needle.size() < n; )
+                needle += (rand() % 8 == 0) ? "b" : "a";
+            break;
+        }
+        if (i % 3 != 2 && hay.size() > needle.size())
+            hay.replace(rand() % (hay.size() - needle.size()), needle.size(),
+                        (i % 3 == 0) ? stx::string::toupper(needle) : needle);
+
+        std::string::size_type pos = rand() % 4;
+
+        CHECK( searcher(needle).find(hay, pos) == hay.find(needle, pos) );
+        CHECK( searcher(needle, true).find(hay, pos) ==
+               stx::string::find_icase(hay, needle, pos) );
+
+        std::string sep = needle.substr(0, rand() % 3 + 1);
+        CHECK( stx::string::split(hay, searcher(sep)) == stx::string::split(hay, sep) );
+        CHECK( stx::string::replace_all(hay, searcher(needle), "-") ==
+               stx::string::replace_all(hay, needle, "-") );
+    }
 }
 
 void test_random()
@@ -439,6 +1426,144 @@ void test_levenshtein()
     CHECK( stx::string::levenshtein_icase("Test this distance", "to this one") == 9 );
 }
 
+void test_string_sort()
+{
+    // sizes below and above the radix sort cutoff, with shared prefixes
+    static const char* cset = "aAbBz/.09";
+
+    for (unsigned int n = 0; n <= 5000; n += 1250)
+    {
+        std::vector<std::string> v(n + 3);
+        for (size_t i = 0; i < v.size(); ++i) {
+            v[i] = stx::string::random(rand() % 8, cset);
+            if (i % 7 == 0) v[i] = "/usr/share/doc/" + v[i];
+        }
+        v[0] = std::string("a\0b", 3);
+        v[1] = "\xE4";
+        v[2] = "";
+
+        std::vector<std::string> s1 = v, s2 = v;
+        std::vector<size_t> lcp;
+        stx::string::string_sort(s1, false, &lcp);
+        std::sort(s2.begin(), s2.end());
+        CHECK( s1 == s2 );
+        CHECK( lcp.size() == s1.size() && lcp[0] == 0 );
+        for (size_t i = 1; i < s1.size(); ++i) {
+            size_t l = 0, m = std::min(s1[i - 1].size(), s1[i].size());
+            while (l < m && s1[i - 1][l] == s1[i][l]) ++l;
+            CHECK( lcp[i] == l );
+        }
+
+        s1 = v;
+        stx::string::string_sort(s1, true, &lcp);
+        for (size_t i = 1; i < s1.size(); ++i) {
+            CHECK( !stx::string::less_icase(s1[i], s1[i - 1]) );
+            CHECK( lcp[i] == stx::string::mismatch_icase(
+                       s1[i - 1].data(), s1[i].data(),
+                       std::min(s1[i - 1].size(), s1[i].size())) );
+        }
+
+        std::vector<size_t> index = stx::string::string_sort_index(v);
+        for (size_t i = 0; i < index.size(); ++i)
+            CHECK( v[index[i]] == s2[i] );
+
+        std::vector<stx::string::string_ref> refs(v.begin(), v.end());
+        stx::string::string_sort(refs);
+        for (size_t i = 0; i < refs.size(); ++i)
+            CHECK( refs[i] == s2[i] );
+    }
+
+    // shuffled nested prefixes, one string ending at each radix level
+    std::string base(12000, 'a');
+    std::vector<stx::string::string_ref> nested;
+    for (size_t i = 1; i <= base.size(); ++i)
+        nested.push_back(stx::string::string_ref(base.data(), i));
+    for (size_t i = nested.size() - 1; i > 0; --i)
+        std::swap(nested[i], nested[rand() % (i + 1)]);
+
+    stx::string::string_sort(nested);
+    for (size_t i = 0; i < nested.size(); ++i)
+        CHECK( nested[i].size() == i + 1 );
+}
+
+void test_string_dict()
+{
+    typedef stx::string::string_dict string_dict;
+
+    std::set<std::string> keys;
+    for (unsigned int i = 0; i < 1000; ++i)
+        keys.insert("key/" + stx::string::random(rand() % 6, "ab\xFF"));
+    keys.insert("");
+
+    std::vector<std::string> sorted(keys.begin(), keys.end());
+    std::string image = string_dict::build(sorted.begin(), sorted.end(),
+                                           string_dict::order_binary, 7);
+    string_dict dict(image.data(), image.size());
+
+    CHECK( dict.size() == sorted.size() );
+    CHECK( std::equal(dict.begin(), dict.end(), sorted.begin()) );
+    CHECK( dict[0] == "" && dict[dict.size() - 1] == sorted.back() );
+
+    for (unsigned int i = 0; i < 500; ++i)
+    {
+        std::string key = "key/" + stx::string::random(rand() % 6, "ab\xFF");
+        size_t lb = std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin();
+
+        CHECK( dict.lower_bound(key).index() == lb );
+        CHECK( dict.contains(key) == (keys.count(key) != 0) );
+
+        std::pair<string_dict::const_iterator, string_dict::const_iterator> range =
+            dict.prefix_range(key);
+        for (size_t j = 0; j < sorted.size(); ++j) {
+            bool in_range = (j >= range.first.index() && j < range.second.index());
+            CHECK( in_range == stx::string::is_prefix(sorted[j], key) );
+        }
+    }
+    CHECK( dict.find("nokey") == dict.end() );
+
+    // natural order dictionary
+    std::set<std::string, stx::string::order_natless_icase> natkeys;
+    for (unsigned int i = 0; i < 1000; ++i)
+        natkeys.insert(stx::string::random(rand() % 8, "aB019 "));
+
+    std::string natimage = string_dict::build(natkeys.begin(), natkeys.end(),
+                                              string_dict::order_natural_icase);
+    string_dict natdict(natimage.data(), natimage.size());
+
+    CHECK( natdict.size() == natkeys.size() );
+    CHECK( std::equal(natdict.begin(), natdict.end(), natkeys.begin()) );
+
+    for (unsigned int i = 0; i < 500; ++i)
+    {
+        std::string key = stx::string::random(rand() % 8, "aB019 ");
+        size_t lb = std::distance(natkeys.begin(), natkeys.lower_bound(key));
+        CHECK( natdict.lower_bound(key).index() == lb );
+        CHECK( natdict.contains(key) == (natkeys.count(key) != 0) );
+    }
+
+    // unsorted input and broken images are rejected
+    std::vector<std::string> unsorted(sorted.rbegin(), sorted.rend());
+    CHECK_THROW( string_dict::build(unsorted.begin(), unsorted.end()), std::runtime_error );
+    CHECK_THROW( string_dict(image.data(), image.size() - 1), std::runtime_error );
+
+    string_dict empty;
+    CHECK( empty.empty() && empty.begin() == empty.end() );
+    CHECK( empty.lower_bound("x") == empty.end() );
+
+#if defined(__unix__) || defined(__APPLE__)
+    FILE* tmp = tmpfile();
+    CHECK( tmp != NULL );
+    fwrite(image.data(), 1, image.size(), tmp);
+    fflush(tmp);
+
+    stx::string::mapped_file file(fileno(tmp));
+    string_dict mdict(file.data(), file.size());
+    CHECK( std::equal(mdict.begin(), mdict.end(), sorted.begin()) );
+    CHECK( mdict.find(sorted[42]).index() == 42 );
+    fclose(tmp);
+#endif
+}
+
 #if HAVE_OPENSSL
 void test_crypto_digest()
 {
@@ -455,19 +1580,37 @@ int main()
     test_trim();
     test_toupper_tolower();
     test_compare_icase();
+    test_icase_hash();
+    test_icase_string();
+    test_utf8_casefold();
     test_sstream();
     test_prefix_suffix();
     test_replace();
+    test_multi_replacer();
+    test_scan();
     test_split_ws();
     test_split();
+    test_split_view();
+    test_split_range();
+    test_split_parallel();
+    test_split_any();
+    test_split_csv();
+    test_string_table();
     test_join();
+    test_concat();
+    test_record_reader();
     test_contains();
+    test_word_matcher();
     test_extract_between();
+    test_find_icase();
+    test_searcher();
     test_random();
     test_hexdump();
     test_base64();
     test_uri_decode();
     test_levenshtein();
+    test_string_sort();
+    test_string_dict();
 
 #if HAVE_OPENSSL
     test_crypto_digest();